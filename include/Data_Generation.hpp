@@ -1,6 +1,10 @@
 #ifndef __Data_Generation_hpp_
 #define __Data_Generation_hpp_
 
+#include <atomic>
+#include <cstdint>
+#include <mpi.h>
+#include <string>
 #include <vector>
 
 #include "libphysica/Natural_Units.hpp"
@@ -8,6 +12,7 @@
 
 #include "obscura/DM_Particle.hpp"
 
+#include "Simulation_Batch.hpp"
 #include "Simulation_Trajectory.hpp"
 
 namespace DaMaSCUS_SUN
@@ -23,39 +28,151 @@ class Simulation_Data
 	unsigned int minimum_number_of_scatterings = 1;
 	unsigned int maximum_number_of_scatterings = 1000;
 	unsigned long int maximum_free_time_steps  = 1e7;
+	unsigned int threads_per_process		   = 1;
+	std::string termination_protocol		   = "Ring";
+	std::string data_reduction				   = "Allgather";
+	std::string data_reduction_file			   = "Reflection_Data.bin";
+	std::uint64_t random_seed				   = 0;
+	double speed_bias_exponent				   = 0.0;
+	double impact_parameter_bias			   = 1.0;
+	std::vector<double> splitting_speeds;
+	unsigned int splitting_factor	= 2;
+	unsigned int histogram_bins		= 0;
+	double histogram_maximum_speed	= 0.02;
+	unsigned int batch_lanes		= 0;
+	bool capture_short_circuit		= false;
+	unsigned int capture_collisions	= 10;
+	bool optical_depth_sampling		= false;
+	bool diffusion_acceleration		= false;
 
 	// Results
 	unsigned long int number_of_trajectories;
 	unsigned long int number_of_free_particles;
 	unsigned long int number_of_reflected_particles;
 	unsigned long int number_of_captured_particles;
+	unsigned long int number_of_short_circuited_particles;
+	double weighted_free_particles, weighted_reflected_particles, weighted_captured_particles;
 	double average_number_of_scatterings;
 	double computing_time;
+	unsigned long int overshoot_trajectories;
 
 	std::vector<unsigned long int> number_of_data_points;
+	std::vector<double> weighted_data_points;
+	// Sums of the weights and squared weights of the samples above the speed threshold, two per ring.
+	// The data generation stops, once Kish's effective sample size (sum w)^2 / sum w^2 of every ring reaches the minimum sample size.
+	std::vector<double> sample_weight_sums;
+	double Smallest_Effective_Sample_Size(const std::vector<double>& weight_sums) const;
+	double reduction_time;
+
+	// Streaming mode: weighted histogram of one isoreflection ring on [Minimum_Speed(), histogram_maximum_speed], which replaces the data points.
+	// Speeds above the range are not binned, but their weight is counted as overflow. The sums include them and are needed for the ratios, the sample sizes, and the KDE bandwidth.
+	struct Speed_Histogram
+	{
+		std::vector<double> weights;
+		double data_points = 0.0, weight_sum = 0.0, weight_squared_sum = 0.0, weighted_speed_sum = 0.0, weighted_speed_squared_sum = 0.0;
+		double lowest_speed, highest_speed;
+		double overflow_weight = 0.0;
+	};
+	std::vector<Speed_Histogram> histograms;
+	Speed_Histogram Empty_Histogram() const;
+	void Fill_Histogram(Speed_Histogram& histogram, double speed, double weight) const;
+	void Merge_Histogram(Speed_Histogram& histogram, const Speed_Histogram& other) const;
+	void Perform_MPI_Histogram_Reductions();
+	// Weighted mean speed and its uncertainty
+	std::vector<double> Average_Speed(unsigned int iso_ring);
+
+	// Results of one thread, which get merged after the data generation
+	struct Thread_Buffer
+	{
+		unsigned long int number_of_trajectories		= 0;
+		unsigned long int number_of_free_particles		= 0;
+		unsigned long int number_of_reflected_particles = 0;
+		unsigned long int number_of_captured_particles	= 0;
+		double number_of_scatterings					= 0.0;
+		double weighted_free_particles					= 0.0;
+		double weighted_reflected_particles				= 0.0;
+		double weighted_captured_particles				= 0.0;
+		std::vector<std::vector<libphysica::DataPoint>> data;
+		std::vector<Speed_Histogram> histograms;
+		std::vector<double> sample_weight_sums;
+		std::vector<double> trajectory_sample_weights;	 // weights of the current initial condition's copies above the threshold per ring
+	};
+	void Simulate_Trajectory(Trajectory_Simulator& simulator, const Initial_Conditions_Generator& initial_conditions_generator, obscura::DM_Particle& DM, const Solar_Model& solar_model, std::uint64_t stream, Thread_Buffer& buffer, std::vector<std::atomic<double>>& local_counter_new);
+	void Simulate_Trajectory_Batch(Trajectory_Batch_Simulator& simulator, const Initial_Conditions_Generator& initial_conditions_generator, obscura::DM_Particle& DM, const Solar_Model& solar_model, std::uint64_t stream, Thread_Buffer& buffer, std::vector<std::atomic<double>>& local_counter_new);
+	void Record_Trajectory(Trajectory_Result trajectory, double weight, const Solar_Model& solar_model, Thread_Buffer& buffer);
+	void Record_Sample_Weights(Thread_Buffer& buffer, std::vector<std::atomic<double>>& local_counter_new);
+	void Merge_Thread_Buffer(const Thread_Buffer& buffer);
+	// Exits with an error, if the batch simulation is combined with options it does not support.
+	void Check_Batch_Simulation() const;
 
 	// MPI
+	MPI_Comm mpi_communicator;
 	int mpi_rank, mpi_processes;
+	// Only the communicator containing the world's process 0 shows progress bars, such that concurrent groups of processes do not interleave theirs.
+	bool print_progress = true;
+	// The trajectory counters, weighted counters, and computing time, which are reduced alike with and without streaming.
+	void Perform_MPI_Counter_Reductions();
 	void Perform_MPI_Reductions();
+	void Collect_Data(bool all_processes);
+	void Collect_Data_MPI_IO();
 
 	double KDE_boundary_correction_factor = 0.75;
 
   public:
+	// In streaming mode, the data points are the centers of the non-empty histogram bins, weighted by the bin contents.
 	std::vector<std::vector<libphysica::DataPoint>> data;
 
 	Simulation_Data(unsigned int sample_size, double u_min = 0.0, unsigned int iso_rings = 1);
 
 	void Configure(double initial_radius, unsigned int min_scattering, unsigned int max_scattering, unsigned long int max_free_steps = 1e8);
-
-	void Generate_Data(obscura::DM_Particle& DM, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, unsigned int fixed_seed = 0);
+	void Set_Number_Of_Threads(unsigned int threads);
+	void Set_Termination_Protocol(const std::string& protocol);
+	// Bias the initial conditions towards fast and central orbits, see Initial_Conditions_Generator::Set_Importance_Sampling(). The data points and ratios carry the statistical weights.
+	void Set_Importance_Sampling(double speed_exponent, double impact_parameter_exponent = 1.0);
+	// Split trajectories above the given asymptotic speeds, see Trajectory_Simulator::splitting_speeds.
+	void Set_Splitting(const std::vector<double>& speeds, unsigned int factor = 2);
+	// Fill weighted speed histograms instead of storing every data point, such that memory and communication do not depend on the sample size. 0 bins switches the streaming mode off.
+	void Set_Streaming_Histograms(unsigned int bins, double maximum_speed = 0.02);
+	bool Streaming() const;
+	// Simulate the trajectories of each thread in batches with the given number of lanes of the Trajectory_Batch_Simulator. 0 lanes switches the batches off.
+	// The batches neither split trajectories nor support the capture short-circuit, the optical depth sampling, or the diffusion acceleration, and Generate_Data() refuses these combinations.
+	void Set_Batch_Simulation(unsigned int lanes);
+	// Stop bound particles early, which cannot gain enough energy to escape within the given number of collisions, see Trajectory_Simulator::capture_short_circuit.
+	// The batch simulation does not support the short-circuit.
+	void Set_Capture_Short_Circuit(bool short_circuit, unsigned int collisions = 10);
+	// Locate the scattering points by integrating the optical depth along the steps, see Trajectory_Simulator::optical_depth_sampling. The batch simulation does not support it.
+	void Set_Optical_Depth_Sampling(bool sampling);
+	// Replace runs of collisions of bound particles in dense regions by single diffusion steps, see Trajectory_Simulator::diffusion_acceleration. The batch simulation does not support it.
+	void Set_Diffusion_Acceleration(bool acceleration);
+	// "Allgather" gives every process the complete data set. "Gather" collects it only on process 0, and "MPI-IO" does the same via a temporary file written collectively by all processes.
+	void Set_Data_Reduction(const std::string& strategy, const std::string& filename = "Reflection_Data.bin");
+	// The simulation is distributed over the processes of the communicator, by default all of them.
+	void Set_MPI_Communicator(MPI_Comm communicator);
+	// Whether this process holds the complete data set, e.g. to compute the reflection spectra.
+	bool Data_Available() const;
+
+	// Every trajectory uses its own random number stream, keyed by the seed, the stream of the process and thread, and the trajectory's index.
+	// Without a fixed seed, process 0 draws a random one, which is shown in the summary to reproduce the run.
+	void Generate_Data(obscura::DM_Particle& DM, const Solar_Model& solar_model, obscura::DM_Distribution& halo_model, unsigned int fixed_seed = 0);
 
 	double Free_Ratio() const;
 	double Capture_Ratio() const;
 	double Reflection_Ratio(int isoreflection_ring = -1) const;
+	// Kish's effective sample size (sum w)^2 / sum w^2 of the samples above the speed threshold
+	double Effective_Sample_Size(unsigned int iso_ring = 0) const;
+	unsigned long int Overshoot_Trajectories() const;
+	std::uint64_t Random_Seed() const;
 
 	double Minimum_Speed() const;
 	double Lowest_Speed(unsigned int iso_ring = 0) const;
 	double Highest_Speed(unsigned int iso_ring = 0) const;
+	// Silverman's rule of thumb from the streamed moments, or 0 without streaming, where the KDE finds the bandwidth from the data points.
+	double KDE_Bandwidth(unsigned int iso_ring = 0) const;
+	// The bin contents of the streamed histogram on [Minimum_Speed(), Minimum_Speed() + bins * Histogram_Bin_Width()], only in streaming mode.
+	const std::vector<double>& Histogram_Weights(unsigned int iso_ring = 0) const;
+	double Histogram_Bin_Width() const;
+	// Fraction of the streamed weight above the histogram's maximum speed, which is missing in the bins.
+	double Histogram_Overflow(unsigned int iso_ring = 0) const;
 
 	void Print_Summary(unsigned int mpi_rank = 0);
 };
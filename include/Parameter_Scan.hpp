@@ -1,20 +1,47 @@
 #ifndef __Parameter_Scan_hpp__
 #define __Parameter_Scan_hpp__
 
+#include <mpi.h>
 #include <vector>
 
 #include "obscura/Configuration.hpp"
 #include "obscura/DM_Particle.hpp"
 #include "obscura/Direct_Detection.hpp"
 
+#include "Data_Generation.hpp"
 #include "Solar_Model.hpp"
 
 namespace DaMaSCUS_SUN
 {
 
-// 1. Configuration class for input file, which extends the obscura::Configuration class.
+// 1. Settings of the simulations behind each p value, and the configuration class for input file, which extends the obscura::Configuration class by them.
+struct Simulation_Settings
+{
+	unsigned int sample_size							 = 100;
+	unsigned int interpolation_points					 = 1000;
+	double interpolation_accuracy						 = 0.0;
+	unsigned int threads_per_process					 = 1;
+	std::string termination_protocol					 = "Ring";
+	std::string data_reduction							 = "Allgather";
+	double importance_sampling_speed_exponent			 = 0.0;
+	double importance_sampling_impact_parameter_exponent = 1.0;
+	std::vector<double> splitting_speeds;
+	unsigned int splitting_factor	= 2;
+	unsigned int batch_lanes		= 0;
+	unsigned int histogram_bins		= 0;
+	double histogram_maximum_speed	= 0.02;
+	bool capture_short_circuit		= false;
+	unsigned int capture_collisions	= 10;
+	bool optical_depth_sampling		= false;
+	bool diffusion_acceleration		= false;
+	bool binned_KDE					= false;
+	std::string rate_table_cache_directory;	  // empty to disable the cache of the rate tables
+};
+
+// Passes the settings on to the data set, whose temporary data reduction file is given separately.
+void Configure_Simulation_Data(Simulation_Data& data_set, const Simulation_Settings& settings, const std::string& reduction_file);
 
-class Configuration : public obscura::Configuration
+class Configuration : public obscura::Configuration, public Simulation_Settings
 {
   protected:
 	void Import_Parameter_Scan_Parameter();
@@ -24,8 +51,9 @@ class Configuration : public obscura::Configuration
 
   public:
 	std::string run_mode;
-	unsigned int isoreflection_rings, interpolation_points;
-	unsigned int sample_size, cross_sections;
+	unsigned int isoreflection_rings;
+	unsigned int cross_sections;
+	unsigned int scan_process_groups;
 	double cross_section_min, cross_section_max;
 	bool compute_halo_constraints, perform_full_scan;
 	explicit Configuration(std::string cfg_filename, int MPI_rank = 0);
@@ -36,7 +64,33 @@ class Configuration : public obscura::Configuration
 // 2. 	Class to perform parameter scans in the (m_DM, sigma)-plane to search for equal-p-value contours.
 //		Either a full scan, or more efficiently and targeted via the square tracing algorithm (STA).
 
-double Compute_p_Value(unsigned int sample_size, obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, unsigned int rate_interpolation_points = 1000, int mpi_rank = 0);
+// The data summary is printed by process 0 of the communicator, if verbose.
+double Compute_p_Value(obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, const Simulation_Settings& settings, bool verbose = true, MPI_Comm mpi_communicator = MPI_COMM_WORLD);
+
+// Work queue of the full scan: the grid points with unknown p value, row by row from the largest coupling down, each from the largest mass down.
+// Once all points of a row are known, and none of them is excluded, the scan is finished, and the queue hands out no more points.
+class Full_Scan_Queue
+{
+  private:
+	std::vector<std::vector<double>>& p_value_grid;
+	double p_critical;
+	std::vector<std::vector<int>> points;
+	std::vector<unsigned int> pending_points;	// unknown p values per row
+	unsigned int next_point;
+	int row_check;	 // highest row, which is not complete yet or contains no excluded point
+	bool finished;
+	void Check_Rows();
+
+  public:
+	Full_Scan_Queue(std::vector<std::vector<double>>& grid, double p_crit);
+
+	// The next grid point {row, column}, or {-1, -1}, if the queue is empty or the scan is finished.
+	std::vector<int> Next_Point();
+	void Add_Result(int row, int column, double p);
+	bool Finished() const;
+	// After a finished scan, the unknown p values below the last row are set to 1.
+	void Fill_Remaining_Rows();
+};
 
 class Parameter_Scan
 {
@@ -44,7 +98,11 @@ class Parameter_Scan
 	std::string results_path;
 	std::vector<double> DM_masses;
 	std::vector<double> couplings;
-	unsigned int sample_size, scattering_rate_interpolation_points;
+	Simulation_Settings settings;
+	// The scans split the MPI processes into groups, which evaluate different parameter points concurrently.
+	// The STA scan evaluates the current point and speculative neighbours, the full scan distributes the grid points via a work queue.
+	unsigned int process_groups;
+	unsigned int speculative_evaluations, wasted_evaluations;
 	double certainty_level;
 	std::vector<std::vector<double>> p_value_grid;
 	// Check for progress of a previous, incomplete parameter scan to import and continue
@@ -56,15 +114,27 @@ class Parameter_Scan
 	void STA_Go_Left(int& row, int& column, std::string& STA_direction);
 	void STA_Go_Right(int& row, int& column, std::string& STA_direction);
 	void STA_Fill_Gaps();
+	void STA_Evaluate_Frontier(const std::vector<std::vector<int>>& frontier, obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, MPI_Comm group_communicator, unsigned int group, int mpi_rank);
+
+	// Work queue of the full scan, process 0 hands out the grid points to the groups' roots.
+	// Process 0 does not evaluate points itself, since it has to answer the groups without delay. This costs one of the MPI processes, which is why the work queue is only used with several groups.
+	void Full_Scan_Master(unsigned int groups);
+	void Full_Scan_Worker(obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, MPI_Comm group_communicator);
 
 	std::vector<double> Find_Contour_Point(int row, int column, int row_previous, int column_previous, double p_critical);
 
   public:
-	Parameter_Scan(const std::vector<double>& masses, const std::vector<double>& coupl, std::string ID, unsigned int samplesize, unsigned int interpolation_points = 1000, double CL = 0.95);
+	Parameter_Scan(const std::vector<double>& masses, const std::vector<double>& coupl, std::string ID, unsigned int samplesize, unsigned int interpolation_points = 1000, double CL = 0.95, unsigned int threads = 1, std::string protocol = "Ring", std::string reduction = "Allgather", unsigned int groups = 1);
 	Parameter_Scan(Configuration& config);
 
 	void Perform_Full_Scan(obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, int mpi_rank = 0);
 	void Perform_STA_Scan(obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, int mpi_rank = 0);
+	// Number of speculatively evaluated points of the last STA scan, and how many of them the square tracing never visited.
+	unsigned int Speculative_Evaluations() const;
+	unsigned int Wasted_Evaluations() const;
+	// Up to max_points grid points {row, column} with unknown p value, which the STA can reach next from the given position, in breadth-first order of the possible paths. The first one is the current point.
+	// Of two branches, the one after an excluded point (left turn) comes first.
+	std::vector<std::vector<int>> STA_Frontier(int row, int column, const std::string& STA_direction, bool first_excluded_point_found, unsigned int max_points);
 
 	// Compute the excluded contours based on the p_value_grid using STA to find the contour shape.
 	std::vector<std::vector<double>> Limit_Curve();
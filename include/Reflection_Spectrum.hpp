@@ -1,7 +1,10 @@
 #ifndef __Reflection_Spectrum_hpp__
 #define __Reflection_Spectrum_hpp__
 
+#include <vector>
+
 #include "libphysica/Numerics.hpp"
+#include "libphysica/Statistics.hpp"
 
 #include "obscura/DM_Distribution.hpp"
 
@@ -20,7 +23,8 @@ class Reflection_Spectrum : public obscura::DM_Distribution
 
   public:
 	//Constructors
-	Reflection_Spectrum(const Simulation_Data& simulation_data, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, double mDM, int iso_ring = 0);
+	// With binned_KDE, the speed PDF is estimated via Perform_Binned_KDE() instead of the direct KDE, which pays off for large samples. Streamed data is smoothed directly from its histograms via Perform_Histogram_KDE().
+	Reflection_Spectrum(const Simulation_Data& simulation_data, const Solar_Model& solar_model, obscura::DM_Distribution& halo_model, double mDM, int iso_ring = 0, bool binned_KDE = false);
 
 	virtual double PDF_Speed(double v) override;
 
@@ -32,7 +36,16 @@ class Reflection_Spectrum : public obscura::DM_Distribution
 	virtual void Print_Summary(int mpi_rank = 0) override;
 };
 
-double DM_Entering_Rate(Solar_Model& solar_model, obscura::DM_Distribution& halo_model, double mDM);
+double DM_Entering_Rate(const Solar_Model& solar_model, obscura::DM_Distribution& halo_model, double mDM);
+
+// Kernel density estimate with a Gaussian kernel in O(N + M log M) for N data points and M grid points.
+// The weighted data is binned linearly onto the grid and convolved with the kernel via FFT. The counts get reflected at x_min, which is the boundary correction of the direct KDE.
+// A bandwidth of 0 is replaced by Silverman's rule of thumb.
+libphysica::Interpolation Perform_Binned_KDE(const std::vector<libphysica::DataPoint>& data, double x_min, double x_max, double bandwidth = 0.0, unsigned int grid_points = 1024);
+
+// The same KDE for data that is already binned into a histogram with bins of width bin_width starting at x_min, e.g. streamed data.
+// The bins are smoothed directly, without binning their centers a second time.
+libphysica::Interpolation Perform_Histogram_KDE(const std::vector<double>& bin_weights, double x_min, double x_max, double bin_width, double bandwidth);
 
 }	// namespace DaMaSCUS_SUN
 
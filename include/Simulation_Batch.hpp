@@ -0,0 +1,72 @@
+#ifndef __Simulation_Batch_hpp_
+#define __Simulation_Batch_hpp_
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "libphysica/Linear_Algebra.hpp"
+#include "libphysica/Natural_Units.hpp"
+
+#include "obscura/DM_Particle.hpp"
+
+#include "Simulation_Trajectory.hpp"
+#include "Simulation_Utilities.hpp"
+#include "Solar_Model.hpp"
+
+namespace DaMaSCUS_SUN
+{
+
+// Simulator which advances a batch of trajectories in lock-step, one particle per lane.
+// The orbital plane coordinates of all lanes are stored as structure of arrays, so that the Runge-Kutta step is a branch-free loop over the lanes, which the compiler can vectorize.
+// Lanes whose step gets rejected are masked and retry in the next sweep. Scatterings and finished trajectories are handled lane by lane, and free lanes are refilled with the next initial condition.
+class Trajectory_Batch_Simulator
+{
+  private:
+	const Solar_Model& solar_model;
+	Trajectory_Simulator scalar_simulator;	 // performs the scatterings
+	unsigned int lanes;
+	std::uint64_t random_seed;
+	std::uint64_t simulated_trajectories = 0;
+
+	// Lane state
+	std::vector<double> time, radius, phi, v_radial, angular_momentum, mass, time_step, minus_log_xi;
+	std::vector<libphysica::Vector> axis_x, axis_y;
+	std::vector<unsigned int> rejections;
+	std::vector<unsigned long int> time_steps, scatterings;
+	std::vector<int> trajectory_index;	 // -1 for empty lanes
+
+	// Results of the last Runge-Kutta sweep
+	std::vector<double> radius_new, v_radial_new, phi_new, time_step_new, error_ratio;
+	double error_tolerances[3];
+
+	void Load_Lane(unsigned int lane, const Event& event);
+	void Empty_Lane(unsigned int lane);
+	void Start_Free_Propagation(unsigned int lane, const Event& event, std::mt19937& PRNG);
+	Event Lane_Event(unsigned int lane) const;
+	double Lane_Speed(unsigned int lane) const;
+	void Runge_Kutta_45_Sweep();
+
+  public:
+	unsigned long int maximum_time_steps;
+	unsigned int maximum_scatterings;
+	double maximum_distance;
+	bool analytic_kepler_orbits			 = true;
+	unsigned int maximum_step_rejections = 100;
+	double v_max						 = 0.75;
+
+	Trajectory_Batch_Simulator(const Solar_Model& model, unsigned int number_of_lanes = 8, unsigned long int max_time_steps = 1e8, unsigned int max_scatterings = 500, double max_distance = 1.1 * libphysica::natural_units::rSun);
+
+	unsigned int Lanes() const;
+	void Fix_PRNG_Seed(int fixed_seed);
+
+	// Simulates all trajectories and returns their results in the order of the initial conditions.
+	// Every trajectory draws from its own random number generator, e.g. the stream of Seed_PRNG_Stream() which sampled its initial condition, such that the results do not depend on the lane it ends up in.
+	std::vector<Trajectory_Result> Simulate(const std::vector<Event>& initial_conditions, std::vector<std::mt19937>& PRNGs, obscura::DM_Particle& DM);
+	// Same, with the streams of Seed_PRNG_Stream() for the seed and the number of trajectories simulated so far
+	std::vector<Trajectory_Result> Simulate(const std::vector<Event>& initial_conditions, obscura::DM_Particle& DM);
+};
+
+}	// namespace DaMaSCUS_SUN
+
+#endif
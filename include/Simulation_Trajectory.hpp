@@ -1,8 +1,9 @@
 #ifndef __Simulation_Trajectory_hpp_
 #define __Simulation_Trajectory_hpp_
 
-#include <fstream>
+#include <memory>
 #include <random>
+#include <vector>
 
 #include "libphysica/Natural_Units.hpp"
 
@@ -10,6 +11,7 @@
 
 #include "Simulation_Utilities.hpp"
 #include "Solar_Model.hpp"
+#include "Trajectory_Output.hpp"
 
 namespace DaMaSCUS_SUN
 {
@@ -19,62 +21,134 @@ struct Trajectory_Result
 {
 	Event initial_event, final_event;
 	unsigned long int number_of_scatterings;
+	double weight;	 // statistical weight of split particles, zero if killed by Russian roulette
 
-	Trajectory_Result(const Event& event_ini, const Event& event_final, unsigned long int nScat);
+	Trajectory_Result(const Event& event_ini, const Event& event_final, unsigned long int nScat, double w = 1.0);
 
 	bool Particle_Reflected() const;
 	bool Particle_Free() const;
-	bool Particle_Captured(Solar_Model& solar_model) const;
+	bool Particle_Captured(const Solar_Model& solar_model) const;
 
-	void Print_Summary(Solar_Model& solar_model, unsigned int mpi_rank = 0);
+	void Print_Summary(const Solar_Model& solar_model, unsigned int mpi_rank = 0);
 };
 
+class Free_Particle_Propagator;
+
 // 2. Simulator
 class Trajectory_Simulator
 {
   private:
-	Solar_Model solar_model;
-
-	unsigned int saved_trajectories, saved_trajectories_max;
-	bool save_trajectories = false;
-	double v_max		   = 0.75;
-
-	bool Propagate_Freely(Event& current_event, obscura::DM_Particle& DM, std::ofstream& f);
-
+	// The solar model is shared, not copied, and must outlive the simulator.
+	const Solar_Model& solar_model;
+
+	unsigned int saved_trajectories, saved_trajectories_max, saving_stride;
+	bool save_trajectories		   = false;
+	bool saving_current_trajectory = false;
+	double v_max				   = 0.75;
+	std::shared_ptr<Trajectory_Writer> trajectory_writer;
+	std::vector<Trajectory_Record> trajectory_records;
+
+	bool Propagate_Freely(Event& current_event, obscura::DM_Particle& DM);
+	double Optical_Depth(const Free_Particle_Propagator& particle_propagator, obscura::DM_Particle& DM, double fraction, double rate_before, double& rate_end) const;
+	double Scattering_Step_Fraction(const Free_Particle_Propagator& particle_propagator, obscura::DM_Particle& DM, double optical_depth, double rate_before, double step_optical_depth) const;
+	void Save_Event(const Event& event, obscura::DM_Particle& DM);
+
+	std::vector<double> target_rates;
 	int Sample_Target(obscura::DM_Particle& DM, double r, double DM_speed);
 	libphysica::Vector Sample_Target_Velocity(double temperature, double target_mass, const libphysica::Vector& vel_DM);
 	libphysica::Vector New_DM_Velocity(double cos_scattering_angle, double DM_mass, double target_mass, libphysica::Vector& vel_DM, libphysica::Vector& vel_target);
 
+	unsigned long int diffusion_steps;
+	bool Diffusion_Step(Event& current_event, obscura::DM_Particle& DM, unsigned long int& number_of_scatterings);
+
+	double maximum_temperature;
+	unsigned long int short_circuited_trajectories;
+	bool Particle_Trapped(const Event& current_event, obscura::DM_Particle& DM) const;
+
+	struct Split_Particle
+	{
+		Event initial_event, current_event;
+		unsigned long int number_of_scatterings;
+		unsigned int splitting_level;
+		double weight;
+	};
+	std::vector<Split_Particle> split_particles;
+	unsigned int Splitting_Level(const Event& event) const;
+	Trajectory_Result Continue_Trajectory(Split_Particle particle, obscura::DM_Particle& DM);
+
   public:
 	std::mt19937 PRNG;
 	unsigned long int maximum_time_steps;
 	unsigned int maximum_scatterings;
 	double maximum_distance;
+	bool analytic_kepler_orbits		= true;
+	bool tabulated_target_selection	= true;	 // Only used if the solar model tabulated the target fractions.
+	bool optical_depth_sampling		= false; // Integrate the optical depth along each step and locate the scattering point within the step.
+
+	// Random walk acceleration: A bound particle, whose mean free path is below the given fraction of the local scale height, skips a run of collisions with a single diffusion step.
+	bool diffusion_acceleration			  = false;
+	double diffusion_mean_free_path_ratio = 0.01;
+	double diffusion_step_ratio			  = 0.1;	// rms displacement of one diffusion step in units of the scale height
+
+	// Capture short-circuit: A bound particle stops after a scattering, if it cannot gain the energy to reach the maximum distance within the given number of collisions.
+	bool capture_short_circuit		= false;
+	unsigned int capture_collisions = 10;
+
+	// Splitting and Russian roulette: The asymptotic speed after the first scattering sets a particle's level. A particle, whose asymptotic speed after a later scattering exceeds further thresholds, is split into splitting_factor copies per threshold.
+	// A particle falling below thresholds survives with probability 1 / splitting_factor per threshold. The weights of the results keep all estimates unbiased.
+	std::vector<double> splitting_speeds;	// ascending, empty to disable the splitting
+	unsigned int splitting_factor = 2;
 
 	Trajectory_Simulator(const Solar_Model& model, unsigned long int max_time_steps = 1e8, unsigned int max_scatterings = 500, double max_distance = 1.1 * libphysica::natural_units::rSun);
 
-	void Toggle_Trajectory_Saving(unsigned int max_trajectories = 50);
+	// Saved trajectories go to results/trajectories_<rank>_<simulator>.bin, unless the simulators of one process share another writer.
+	void Toggle_Trajectory_Saving(unsigned int max_trajectories = 50, unsigned int stride = 20, unsigned int simulator_index = 0);
+	void Set_Trajectory_Writer(std::shared_ptr<Trajectory_Writer> writer);
 	void Fix_PRNG_Seed(int fixed_seed);
+	unsigned long int Diffusion_Steps() const;
+	unsigned long int Short_Circuited_Trajectories() const;
 
 	void Scatter(Event& current_event, obscura::DM_Particle& DM);
 	Trajectory_Result Simulate(const Event& initial_condition, obscura::DM_Particle& DM);
+
+	// The copies of a split trajectory have to be simulated before the next call of Simulate().
+	bool Split_Particles_Pending() const;
+	Trajectory_Result Simulate_Split_Particle(obscura::DM_Particle& DM);
 };
 
 // 3. Equation of motion solution with Runge-Kutta-Fehlberg
+// Butcher tableau, which is shared by the Free_Particle_Propagator and the Trajectory_Batch_Simulator. Stage i evaluates the derivatives at the coordinates plus sum_j a[i][j] k[j], and the two solutions add sum_i b[i] k[i].
+constexpr double RKF_a[6][5] = {
+	{0.0, 0.0, 0.0, 0.0, 0.0},
+	{1.0 / 4.0, 0.0, 0.0, 0.0, 0.0},
+	{3.0 / 32.0, 9.0 / 32.0, 0.0, 0.0, 0.0},
+	{1932.0 / 2197.0, -7200.0 / 2197.0, 7296.0 / 2197.0, 0.0, 0.0},
+	{439.0 / 216.0, -8.0, 3680.0 / 513.0, -845.0 / 4104.0, 0.0},
+	{-8.0 / 27.0, 2.0, -3544.0 / 2565.0, 1859.0 / 4104.0, -11.0 / 40.0}};
+constexpr double RKF_b_4[6] = {25.0 / 216.0, 0.0, 1408.0 / 2565.0, 2197.0 / 4104.0, -1.0 / 5.0, 0.0};
+constexpr double RKF_b_5[6] = {16.0 / 135.0, 0.0, 6656.0 / 12825.0, 28561.0 / 56430.0, -9.0 / 50.0, 2.0 / 55.0};
+
 class Free_Particle_Propagator
 {
   private:
 	double time, radius, phi, v_radial;
 	double angular_momentum;
+	double time_previous, radius_previous, phi_previous, v_radial_previous;	  // start of the last accepted step
 	libphysica::Vector axis_x, axis_y, axis_z;
 
 	double dr_dt(double v);
 	double dv_dt(double r, double mass);
 	double dphi_dt(double r);
-	std::vector<double> error_tolerances;
+	double error_tolerances[3];
+
+	void Interpolate_Coordinates(double fraction, double& r, double& v_r, double& phi_interpolated) const;
+
+	// Step statistics
+	unsigned long int accepted_steps, rejected_steps;
 
   public:
-	double time_step = 0.1 * libphysica::natural_units::sec;
+	double time_step					 = 0.1 * libphysica::natural_units::sec;
+	unsigned int maximum_step_rejections = 100;
 
 	explicit Free_Particle_Propagator(const Event& event);
 
@@ -84,6 +158,14 @@ class Free_Particle_Propagator
 	double Current_Radius();
 	double Current_Speed();
 
+	// Cubic Hermite interpolation within the last accepted step, where the fraction runs from 0 (start) to 1 (end of the step).
+	void Interpolate_Last_Step(double fraction, double& r, double& v) const;
+	void Rewind_Last_Step(double fraction);
+	double Last_Time_Step() const;
+
+	unsigned long int Accepted_Steps() const;
+	unsigned long int Rejected_Steps() const;
+
 	Event Event_In_3D();
 };
 
@@ -1,6 +1,8 @@
 #ifndef __Simulation_Utilities_hpp_
 #define __Simulation_Utilities_hpp_
 
+#include <array>
+#include <cstdint>
 #include <random>
 
 #include "libphysica/Linear_Algebra.hpp"
@@ -26,7 +28,7 @@ struct Event
 	double Radius() const;
 	double Speed() const;
 	double Angular_Momentum() const;
-	double Asymptotic_Speed_Sqr(Solar_Model& solar_model) const;
+	double Asymptotic_Speed_Sqr(const Solar_Model& solar_model) const;
 
 	double Isoreflection_Angle(const libphysica::Vector& vel_sun) const;
 	int Isoreflection_Ring(const libphysica::Vector& vel_sun, unsigned int number_of_rings) const;
@@ -38,14 +40,56 @@ struct Event
 };
 
 // 2. Generator of initial conditions
-extern Event Initial_Conditions(obscura::DM_Distribution& halo_model, Solar_Model& model, std::mt19937& PRNG);
+extern Event Initial_Conditions(obscura::DM_Distribution& halo_model, const Solar_Model& model, std::mt19937& PRNG);
+
+// Generator which tabulates the CDFs of the initial speed and the conditional CDFs of cos(theta) once, and samples the initial conditions via inverse transform sampling.
+class Initial_Conditions_Generator
+{
+  private:
+	libphysica::Vector vel_sun;
+	double v_gal, v_esc_sun, v_esc_asymptotic, asymptotic_distance;
+
+	std::vector<double> speeds, speed_pdf, speed_cdf;
+
+	// Importance sampling towards fast and central orbits
+	double speed_bias_exponent, impact_parameter_bias, speed_bias_normalization;
+	std::vector<double> biased_speed_cdf;
+
+	// Conditional CDFs of cos(theta) for a grid of speeds, tabulated in x = (cos(theta) + 1) / (cos_theta_max(u) + 1) in [0,1]
+	std::vector<double> cos_theta_speeds, cos_theta_x;
+	std::vector<std::vector<double>> cos_theta_cdfs;
+
+	double Cos_Theta_Max(double u) const;
+	double Inverse_CDF(const std::vector<double>& grid, const std::vector<double>& cdf, double xi) const;
+
+  public:
+	Initial_Conditions_Generator(obscura::DM_Distribution& halo_model, const Solar_Model& solar_model, unsigned int speed_grid_points = 1000, unsigned int cos_theta_grid_points = 100);
+
+	Event Initial_Conditions(std::mt19937& PRNG) const;
+
+	// Weighted sampling mode: The speeds u get drawn from their pdf times (u / u_max)^speed_bias_exponent, and the squared impact parameters in units of their maximum s = xi^impact_parameter_bias.
+	// The weight of an event is the ratio of the physical and the biased pdf, so that weighted averages are unbiased. Without bias, all weights are one.
+	void Set_Importance_Sampling(double speed_exponent, double impact_parameter_exponent = 1.0);
+	Event Initial_Conditions(std::mt19937& PRNG, double& event_weight) const;
+};
 
 // 3. Analytically propagate a particle at event on a hyperbolic Kepler orbit to a radius R (without passing the periapsis)
 extern void Hyperbolic_Kepler_Shift(Event& event, double R_final);
 
+// Analytically propagate a particle at event forward in time on its Kepler orbit (elliptic or hyperbolic) to the next passage of the radius R, including the time of flight.
+// Returns false without changing the event, if the orbit never reaches R or cannot be described by the orbital angle (radial or circular orbits).
+extern bool Kepler_Shift(Event& event, double R_final);
+
 // 4. Equiareal isoreflection rings
 extern std::vector<double> Isoreflection_Ring_Angles(unsigned int number_of_rings);
 
+// 5. Counter-based random number streams
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", 2011) maps a 128-bit counter and a 64-bit key to 128 random bits.
+extern std::array<std::uint32_t, 4> Philox_4x32(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key);
+
+// Seed the PRNG for one trajectory, identified by the global seed, the stream (e.g. MPI process and thread), and the trajectory's index in that stream.
+extern void Seed_PRNG_Stream(std::mt19937& PRNG, std::uint64_t global_seed, std::uint64_t stream, std::uint64_t trajectory);
+
 }	// namespace DaMaSCUS_SUN
 
 #endif
\ No newline at end of file
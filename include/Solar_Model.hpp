@@ -1,6 +1,10 @@
 #ifndef __Solar_Model_hpp_
 #define __Solar_Model_hpp_
 
+#include <mpi.h>
+#include <string>
+#include <vector>
+
 #include "libphysica/Linear_Algebra.hpp"
 #include "libphysica/Numerics.hpp"
 
@@ -14,19 +18,32 @@ namespace DaMaSCUS_SUN
 class Solar_Isotope : public obscura::Isotope
 {
   private:
-	libphysica::Interpolation number_density;
+	mutable libphysica::Interpolation number_density;
 
   public:
 	Solar_Isotope(const obscura::Isotope& isotope, const std::vector<std::vector<double>>& density_table, double abundance = 1.0);
 
-	double Number_Density(double r);
+	double Number_Density(double r) const;
+	double Number_Density_Derivative(double r) const;
 };
 
 // 2. Solar model
+// Position of a radius on the model's uniform radial grid, found once and reused for all profiles.
+struct Radial_Grid_Point
+{
+	double radius;
+	unsigned int offset;
+	double weight;
+	double basis[4];	// cubic Hermite basis functions of the grid interval
+};
+
+// All queries are const and reentrant, so that one instance can be shared by many simulators and threads.
+// The evaluation of libphysica's interpolations does not change them, but is not declared const, hence the mutable members.
+// Only Interpolate_Total_DM_Scattering_Rate() changes the model and must not run concurrently with any query.
 class Solar_Model
 {
   private:
-	libphysica::Interpolation mass, temperature, local_escape_speed_squared, mass_density;
+	mutable libphysica::Interpolation mass, temperature, local_escape_speed_squared, mass_density;
 
 	// Auxiliary functions for the data import
 	std::vector<std::vector<double>> raw_data;
@@ -37,11 +54,48 @@ class Solar_Model
 	std::vector<std::vector<double>> Create_Number_Density_Table_Electron();
 
 	// Solar electrons
-	libphysica::Interpolation number_density_electron;
+	mutable libphysica::Interpolation number_density_electron;
 
 	// Interpolation of total scattering rate
+	// The rate scales with the coupling, so the interpolation is a reference table times a scale factor. The probe rates detect, whether a new DM particle differs only by the coupling.
 	bool using_interpolated_rate;
-	libphysica::Interpolation_2D rate_interpolation;
+	mutable libphysica::Interpolation_2D rate_interpolation;
+	double rate_scale_factor;
+	unsigned int rate_table_N_radius, rate_table_N_speed;
+	double rate_table_DM_mass, rate_table_reference_rate;
+	std::vector<double> rate_table_probes;
+	double rate_table_accuracy;	  // 0 for uniform grids
+	double rate_table_build_time;
+	std::vector<double> rate_table_radii, rate_table_speeds;
+	std::vector<double> Refine_Rate_Grid(obscura::DM_Particle& DM, std::vector<double> grid, bool radial_grid, const std::vector<double>& fixed_coordinates, double relative_accuracy, unsigned int max_nodes) const;
+	void Build_Rate_Table(obscura::DM_Particle& DM, const std::vector<double>& radii, const std::vector<double>& speeds, double relative_accuracy);
+
+	// Processes computing the rate table together
+	MPI_Comm mpi_communicator;
+
+	// On-disk cache of the rate tables, keyed by a hash of the DM mass, the grid, and the coupling-independent shape of the rate.
+	// A cached table serves all cross sections of a DM mass by rescaling.
+	std::string rate_table_cache_directory;
+	// The cache files contain the target fractions, too.
+	std::vector<double> Rate_Probes(obscura::DM_Particle& DM) const;
+	std::string Rate_Table_Cache_File(double DM_mass, const std::vector<double>& probes, unsigned int N_radius, unsigned int N_speed, double relative_accuracy) const;
+	std::vector<std::vector<double>> Import_Rate_Table(const std::string& filename, double& table_reference_rate);
+	void Export_Rate_Table(const std::string& filename, const std::vector<std::vector<double>>& rates, double reference_rate) const;
+
+	// Cumulative rate fractions of all targets (electrons first) on a coarser (r, v) grid for the target selection
+	bool using_tabulated_targets;
+	unsigned int target_table_radii, target_table_speeds;
+	double target_table_radius_step, target_table_speed_step;
+	std::vector<double> target_fractions;
+
+	// All profiles resampled on a uniform radial grid, with the profiles of one grid node stored next to each other in a single block.
+	// Each block holds the values, followed by the derivatives times the grid spacing, for a cubic Hermite interpolation between the nodes.
+	unsigned int radial_grid_intervals;
+	double radial_grid_spacing;
+	unsigned int profiles_per_node;
+	std::vector<double> radial_profiles;
+	void Tabulate_Radial_Profiles(unsigned int grid_intervals);
+	double Tabulated_Profile(const Radial_Grid_Point& point, unsigned int profile) const;
 
   public:
 	std::string name;
@@ -49,23 +103,59 @@ class Solar_Model
 
 	Solar_Model();
 
-	double Mass(double r);
-	double Mass_Density(double r);
-	double Temperature(double r);
-	double Local_Escape_Speed(double r);
-	double Debye_Screening_Scale_Squared(double r);
+	double Mass(double r) const;
+	double Mass_Density(double r) const;
+	double Temperature(double r) const;
+	double Local_Escape_Speed(double r) const;
+	double Debye_Screening_Scale_Squared(double r) const;
+
+	double Number_Density_Nucleus(double r, unsigned int nucleus_index) const;
+	double Number_Density_Electron(double r) const;
+
+	double DM_Scattering_Rate_Electron(obscura::DM_Particle& DM, double r, double DM_speed) const;
+	double DM_Scattering_Rate_Nucleus(obscura::DM_Particle& DM, double r, double DM_speed, unsigned int nucleus_index) const;
+
+	// Lookups on the uniform radial grid without any search, used in the simulation's hot loops.
+	Radial_Grid_Point Radial_Grid_Lookup(double r) const;
+	double Mass(const Radial_Grid_Point& point) const;
+	double Mass_Density(const Radial_Grid_Point& point) const;
+	double Temperature(const Radial_Grid_Point& point) const;
+	double Local_Escape_Speed(const Radial_Grid_Point& point) const;
+	double Number_Density_Nucleus(const Radial_Grid_Point& point, unsigned int nucleus_index) const;
+	double Number_Density_Electron(const Radial_Grid_Point& point) const;
+	// Smaller one of the mass density and temperature scale heights |f / f'|
+	double Scale_Height(const Radial_Grid_Point& point) const;
 
-	double Number_Density_Nucleus(double r, unsigned int nucleus_index);
-	double Number_Density_Electron(double r);
+	double DM_Scattering_Rate_Electron(obscura::DM_Particle& DM, const Radial_Grid_Point& point, double DM_speed) const;
+	double DM_Scattering_Rate_Nucleus(obscura::DM_Particle& DM, const Radial_Grid_Point& point, double DM_speed, unsigned int nucleus_index) const;
 
-	double DM_Scattering_Rate_Electron(obscura::DM_Particle& DM, double r, double DM_speed);
-	double DM_Scattering_Rate_Nucleus(obscura::DM_Particle& DM, double r, double DM_speed, unsigned int nucleus_index);
+	// Electron rate (first entry) followed by the rates of all isotopes, computed in one pass into a reusable buffer.
+	void DM_Scattering_Rates(obscura::DM_Particle& DM, const Radial_Grid_Point& point, double DM_speed, std::vector<double>& rates) const;
 
-	double Total_DM_Scattering_Rate(obscura::DM_Particle& DM, double r, double DM_speed);
-	double Total_DM_Scattering_Rate_Computed(obscura::DM_Particle& DM, double r, double DM_speed);
+	double Total_DM_Scattering_Rate(obscura::DM_Particle& DM, double r, double DM_speed) const;
+	double Total_DM_Scattering_Rate_Computed(obscura::DM_Particle& DM, double r, double DM_speed) const;
 
-	double Total_DM_Scattering_Rate_Interpolated(obscura::DM_Particle& DM, double r, double DM_speed);
+	double Total_DM_Scattering_Rate_Interpolated(obscura::DM_Particle& DM, double r, double DM_speed) const;
 	void Interpolate_Total_DM_Scattering_Rate(obscura::DM_Particle& DM, unsigned int N_radius, unsigned int N_speed);
+	// Non-uniform grid, refined by bisection until the linear interpolation along radial and speed lines meets the relative accuracy.
+	void Interpolate_Total_DM_Scattering_Rate_Adaptive(obscura::DM_Particle& DM, double relative_accuracy, unsigned int max_nodes = 1000);
+	double Rate_Table_Memory() const;	  // in bytes
+	double Rate_Table_Build_Time() const;	  // in seconds
+	std::vector<unsigned int> Rate_Table_Grid() const;
+	void Print_Rate_Table_Summary(int mpi_rank = 0) const;
+	// Rescales the reference table, if the DM particle differs from the table's one only by the coupling. Returns false otherwise.
+	bool Rescale_Total_DM_Scattering_Rate(obscura::DM_Particle& DM);
+	// The rate table and the target fractions are computed by the processes of the communicator, by default all of them.
+	void Set_MPI_Communicator(MPI_Comm communicator);
+	// Tables are cached as binary files in the given directory, an empty string disables the cache.
+	void Use_Rate_Table_Cache(const std::string& directory);
+	// Cache file of a table with the given grid dimensions, after the uniform radial grid got rounded to the number of MPI processes.
+	std::string Rate_Table_Cache_File(obscura::DM_Particle& DM, unsigned int N_radius, unsigned int N_speed, double relative_accuracy = 0.0) const;
+
+	// Collective over the processes of the communicator, which share the radii of the table.
+	void Tabulate_Target_Fractions(obscura::DM_Particle& DM, unsigned int N_radius = 100, unsigned int N_speed = 100);
+	bool Target_Fractions_Tabulated(double DM_speed) const;
+	int Sample_Target_Tabulated(double r, double DM_speed, double xi) const;
 
 	void Print_Summary(int mpi_rank = 0) const;
 };
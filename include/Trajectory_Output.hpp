@@ -0,0 +1,52 @@
+#ifndef __Trajectory_Output_hpp_
+#define __Trajectory_Output_hpp_
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace DaMaSCUS_SUN
+{
+
+// 1. Fixed binary layout of one saved trajectory point (natural units, host byte order)
+struct Trajectory_Record
+{
+	std::uint64_t trajectory;
+	double time;
+	double position[3];
+	double velocity[3];
+	double energy;
+};
+
+// 2. Buffered binary sink shared by all simulators of one MPI process.
+// The file starts with a short header, followed by fixed-size records, which are only written for complete trajectories.
+// A file cut off by an aborted run therefore stays readable up to its last complete record.
+class Trajectory_Writer
+{
+  private:
+	std::ofstream file;
+	std::mutex file_mutex;
+	std::vector<Trajectory_Record> buffer;
+	unsigned int buffer_size;
+	std::uint64_t number_of_trajectories;
+
+	void Flush_Buffer();
+
+  public:
+	explicit Trajectory_Writer(const std::string& filename, unsigned int buffered_records = 4096);
+	~Trajectory_Writer();
+
+	// Assigns the next trajectory index to the records and appends them. Thread-safe.
+	std::uint64_t Write_Trajectory(std::vector<Trajectory_Record>& records);
+	void Flush();
+};
+
+// 3. Reading the binary files
+extern std::vector<Trajectory_Record> Import_Trajectory_Records(const std::string& filename);
+extern void Convert_Trajectories_To_Text(const std::string& binary_filename, const std::string& text_filename);
+
+}	// namespace DaMaSCUS_SUN
+
+#endif
@@ -2,7 +2,11 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <limits>
 #include <mpi.h>
+#include <random>
+#include <thread>
 
 #include "libphysica/Natural_Units.hpp"
 #include "libphysica/Special_Functions.hpp"
@@ -15,11 +19,19 @@ namespace DaMaSCUS_SUN
 
 using namespace libphysica::natural_units;
 
+// std::atomic<double> has no fetch_add() before C++20.
+static void Atomic_Add(std::atomic<double>& sum, double summand)
+{
+	double old_sum = sum.load();
+	while(!sum.compare_exchange_weak(old_sum, old_sum + summand))
+		;
+}
+
 Simulation_Data::Simulation_Data(unsigned int sample_size, double u_min, unsigned int iso_rings)
-: min_sample_size_above_threshold(sample_size), minimum_speed_threshold(u_min), isoreflection_rings(iso_rings), number_of_trajectories(0), number_of_free_particles(0), number_of_reflected_particles(0), number_of_captured_particles(0), average_number_of_scatterings(0.0), computing_time(0.0), number_of_data_points(std::vector<unsigned long int>(iso_rings, 0)), data(iso_rings, std::vector<libphysica::DataPoint>())
+: min_sample_size_above_threshold(sample_size), minimum_speed_threshold(u_min), isoreflection_rings(iso_rings), number_of_trajectories(0), number_of_free_particles(0), number_of_reflected_particles(0), number_of_captured_particles(0), number_of_short_circuited_particles(0), weighted_free_particles(0.0), weighted_reflected_particles(0.0), weighted_captured_particles(0.0), average_number_of_scatterings(0.0), computing_time(0.0), overshoot_trajectories(0), number_of_data_points(std::vector<unsigned long int>(iso_rings, 0)), weighted_data_points(std::vector<double>(iso_rings, 0.0)), sample_weight_sums(std::vector<double>(2 * iso_rings, 0.0)), reduction_time(0.0), mpi_communicator(MPI_COMM_WORLD), data(iso_rings, std::vector<libphysica::DataPoint>())
 {
-	MPI_Comm_size(MPI_COMM_WORLD, &mpi_processes);
-	MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+	MPI_Comm_size(mpi_communicator, &mpi_processes);
+	MPI_Comm_rank(mpi_communicator, &mpi_rank);
 }
 
 void Simulation_Data::Configure(double initial_radius, unsigned int min_scattering, unsigned int max_scattering, unsigned long int max_free_steps)
@@ -30,10 +42,309 @@ void Simulation_Data::Configure(double initial_radius, unsigned int min_scatteri
 	maximum_free_time_steps		  = max_free_steps;
 }
 
-void Simulation_Data::Generate_Data(obscura::DM_Particle& DM, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, unsigned int fixed_seed)
+void Simulation_Data::Set_Number_Of_Threads(unsigned int threads)
+{
+	threads_per_process = std::max(1u, threads);
+}
+
+void Simulation_Data::Set_Termination_Protocol(const std::string& protocol)
+{
+	if(protocol != "Ring" && protocol != "Allreduce")
+	{
+		std::cerr << "Error in Simulation_Data::Set_Termination_Protocol(): Protocol " << protocol << " not recognized." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	termination_protocol = protocol;
+}
+
+void Simulation_Data::Set_Importance_Sampling(double speed_exponent, double impact_parameter_exponent)
+{
+	if(impact_parameter_exponent <= 0.0)
+	{
+		std::cerr << "Error in Simulation_Data::Set_Importance_Sampling(): The impact parameter exponent must be positive." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	speed_bias_exponent	  = speed_exponent;
+	impact_parameter_bias = impact_parameter_exponent;
+}
+
+void Simulation_Data::Set_Splitting(const std::vector<double>& speeds, unsigned int factor)
+{
+	if(factor < 2 || !std::is_sorted(speeds.begin(), speeds.end()))
+	{
+		std::cerr << "Error in Simulation_Data::Set_Splitting(): The splitting factor must be at least 2 and the speeds ascending." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	splitting_speeds = speeds;
+	splitting_factor = factor;
+}
+
+void Simulation_Data::Set_Streaming_Histograms(unsigned int bins, double maximum_speed)
+{
+	if(bins > 0 && maximum_speed <= Minimum_Speed())
+	{
+		std::cerr << "Error in Simulation_Data::Set_Streaming_Histograms(): The maximum speed must be above the minimum speed." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	histogram_bins			= bins;
+	histogram_maximum_speed	= maximum_speed;
+}
+
+void Simulation_Data::Set_Batch_Simulation(unsigned int lanes)
+{
+	batch_lanes = lanes;
+}
+
+void Simulation_Data::Set_Capture_Short_Circuit(bool short_circuit, unsigned int collisions)
+{
+	if(collisions == 0)
+	{
+		std::cerr << "Error in Simulation_Data::Set_Capture_Short_Circuit(): The number of collisions must be positive." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	capture_short_circuit = short_circuit;
+	capture_collisions	  = collisions;
+}
+
+void Simulation_Data::Set_Optical_Depth_Sampling(bool sampling)
+{
+	optical_depth_sampling = sampling;
+}
+
+void Simulation_Data::Set_Diffusion_Acceleration(bool acceleration)
+{
+	diffusion_acceleration = acceleration;
+}
+
+void Simulation_Data::Set_Data_Reduction(const std::string& strategy, const std::string& filename)
+{
+	if(strategy != "Allgather" && strategy != "Gather" && strategy != "MPI-IO")
+	{
+		std::cerr << "Error in Simulation_Data::Set_Data_Reduction(): Strategy " << strategy << " not recognized." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	data_reduction		= strategy;
+	data_reduction_file	= filename;
+}
+
+void Simulation_Data::Set_MPI_Communicator(MPI_Comm communicator)
+{
+	mpi_communicator = communicator;
+	MPI_Comm_size(mpi_communicator, &mpi_processes);
+	MPI_Comm_rank(mpi_communicator, &mpi_rank);
+
+	MPI_Group group, world_group;
+	MPI_Comm_group(mpi_communicator, &group);
+	MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+	int world_root = 0, group_rank_of_world_root;
+	MPI_Group_translate_ranks(world_group, 1, &world_root, group, &group_rank_of_world_root);
+	print_progress = (group_rank_of_world_root != MPI_UNDEFINED);
+	MPI_Group_free(&group);
+	MPI_Group_free(&world_group);
+}
+
+bool Simulation_Data::Data_Available() const
+{
+	return Streaming() || data_reduction == "Allgather" || mpi_rank == 0;
+}
+
+bool Simulation_Data::Streaming() const
+{
+	return histogram_bins > 0;
+}
+
+Simulation_Data::Speed_Histogram Simulation_Data::Empty_Histogram() const
+{
+	Speed_Histogram histogram;
+	histogram.weights		= std::vector<double>(histogram_bins, 0.0);
+	histogram.lowest_speed	= std::numeric_limits<double>::infinity();
+	histogram.highest_speed	= 0.0;
+	return histogram;
+}
+
+void Simulation_Data::Fill_Histogram(Speed_Histogram& histogram, double speed, double weight) const
+{
+	double bin_width = Histogram_Bin_Width();
+	int bin			 = std::floor((speed - Minimum_Speed()) / bin_width);
+	if(bin < (int) histogram_bins)
+		histogram.weights[std::max(bin, 0)] += weight;
+	else
+		histogram.overflow_weight += weight;
+	histogram.data_points++;
+	histogram.weight_sum += weight;
+	histogram.weight_squared_sum += weight * weight;
+	histogram.weighted_speed_sum += weight * speed;
+	histogram.weighted_speed_squared_sum += weight * speed * speed;
+	histogram.lowest_speed	= std::min(histogram.lowest_speed, speed);
+	histogram.highest_speed = std::max(histogram.highest_speed, speed);
+}
+
+void Simulation_Data::Merge_Histogram(Speed_Histogram& histogram, const Speed_Histogram& other) const
+{
+	for(unsigned int bin = 0; bin < histogram_bins; bin++)
+		histogram.weights[bin] += other.weights[bin];
+	histogram.overflow_weight += other.overflow_weight;
+	histogram.data_points += other.data_points;
+	histogram.weight_sum += other.weight_sum;
+	histogram.weight_squared_sum += other.weight_squared_sum;
+	histogram.weighted_speed_sum += other.weighted_speed_sum;
+	histogram.weighted_speed_squared_sum += other.weighted_speed_squared_sum;
+	histogram.lowest_speed	= std::min(histogram.lowest_speed, other.lowest_speed);
+	histogram.highest_speed = std::max(histogram.highest_speed, other.highest_speed);
+}
+
+void Simulation_Data::Simulate_Trajectory(Trajectory_Simulator& simulator, const Initial_Conditions_Generator& initial_conditions_generator, obscura::DM_Particle& DM, const Solar_Model& solar_model, std::uint64_t stream, Thread_Buffer& buffer, std::vector<std::atomic<double>>& local_counter_new)
+{
+	Seed_PRNG_Stream(simulator.PRNG, random_seed, stream, buffer.number_of_trajectories);
+	double weight;
+	Event IC = initial_conditions_generator.Initial_Conditions(simulator.PRNG, weight);
+	Hyperbolic_Kepler_Shift(IC, initial_and_final_radius);
+	buffer.number_of_trajectories++;
+
+	// The copies of split trajectories are recorded with their share of the initial condition's weight.
+	std::fill(buffer.trajectory_sample_weights.begin(), buffer.trajectory_sample_weights.end(), 0.0);
+	Record_Trajectory(simulator.Simulate(IC, DM), weight, solar_model, buffer);
+	while(simulator.Split_Particles_Pending())
+		Record_Trajectory(simulator.Simulate_Split_Particle(DM), weight, solar_model, buffer);
+
+	Record_Sample_Weights(buffer, local_counter_new);
+}
+
+void Simulation_Data::Simulate_Trajectory_Batch(Trajectory_Batch_Simulator& simulator, const Initial_Conditions_Generator& initial_conditions_generator, obscura::DM_Particle& DM, const Solar_Model& solar_model, std::uint64_t stream, Thread_Buffer& buffer, std::vector<std::atomic<double>>& local_counter_new)
+{
+	// The trajectories use the same random number streams as in Simulate_Trajectory(), which continue in the batch simulator after the initial conditions.
+	std::vector<std::mt19937> PRNGs(simulator.Lanes());
+	std::vector<Event> initial_conditions;
+	std::vector<double> weights;
+	for(auto& PRNG : PRNGs)
+	{
+		Seed_PRNG_Stream(PRNG, random_seed, stream, buffer.number_of_trajectories++);
+		double weight;
+		initial_conditions.push_back(initial_conditions_generator.Initial_Conditions(PRNG, weight));
+		Hyperbolic_Kepler_Shift(initial_conditions.back(), initial_and_final_radius);
+		weights.push_back(weight);
+	}
+	std::vector<Trajectory_Result> results = simulator.Simulate(initial_conditions, PRNGs, DM);
+	for(unsigned int i = 0; i < results.size(); i++)
+	{
+		std::fill(buffer.trajectory_sample_weights.begin(), buffer.trajectory_sample_weights.end(), 0.0);
+		Record_Trajectory(results[i], weights[i], solar_model, buffer);
+		Record_Sample_Weights(buffer, local_counter_new);
+	}
+}
+
+void Simulation_Data::Record_Sample_Weights(Thread_Buffer& buffer, std::vector<std::atomic<double>>& local_counter_new)
+{
+	// The copies share their history up to the split and are therefore not independent. For the effective sample size, all copies of one initial condition count as one sample with their summed weight.
+	for(unsigned int i = 0; i < isoreflection_rings; i++)
+	{
+		double sample_weight = buffer.trajectory_sample_weights[i];
+		if(sample_weight > 0.0)
+		{
+			Atomic_Add(local_counter_new[2 * i], sample_weight);
+			Atomic_Add(local_counter_new[2 * i + 1], sample_weight * sample_weight);
+			buffer.sample_weight_sums[2 * i] += sample_weight;
+			buffer.sample_weight_sums[2 * i + 1] += sample_weight * sample_weight;
+		}
+	}
+}
+
+void Simulation_Data::Record_Trajectory(Trajectory_Result trajectory, double weight, const Solar_Model& solar_model, Thread_Buffer& buffer)
+{
+	// Particles killed by Russian roulette carry no weight.
+	if(trajectory.weight == 0.0)
+		return;
+	weight *= trajectory.weight;
+	buffer.number_of_scatterings += weight * trajectory.number_of_scatterings;
+
+	if(trajectory.Particle_Captured(solar_model))
+	{
+		buffer.number_of_captured_particles++;
+		buffer.weighted_captured_particles += weight;
+	}
+	else
+	{
+		if(trajectory.Particle_Free())
+		{
+			buffer.number_of_free_particles++;
+			buffer.weighted_free_particles += weight;
+		}
+		else if(trajectory.Particle_Reflected())
+		{
+			buffer.number_of_reflected_particles++;
+			buffer.weighted_reflected_particles += weight;
+		}
+		else
+			return;
+
+		Hyperbolic_Kepler_Shift(trajectory.final_event, 1.0 * AU);
+		double v_final = trajectory.final_event.Speed();
+		if(trajectory.number_of_scatterings >= minimum_number_of_scatterings && v_final > KDE_boundary_correction_factor * minimum_speed_threshold)
+		{
+			unsigned int isoreflection_ring = (isoreflection_rings == 1) ? 0 : trajectory.final_event.Isoreflection_Ring(obscura::Sun_Velocity(), isoreflection_rings);
+			if(v_final > minimum_speed_threshold)
+				buffer.trajectory_sample_weights[isoreflection_ring] += weight;
+			if(Streaming())
+				Fill_Histogram(buffer.histograms[isoreflection_ring], v_final, weight);
+			else
+				buffer.data[isoreflection_ring].push_back(libphysica::DataPoint(v_final, weight));
+		}
+	}
+}
+
+void Simulation_Data::Merge_Thread_Buffer(const Thread_Buffer& buffer)
+{
+	unsigned long int number_of_trajectories_old = number_of_trajectories;
+	number_of_trajectories += buffer.number_of_trajectories;
+	number_of_free_particles += buffer.number_of_free_particles;
+	number_of_reflected_particles += buffer.number_of_reflected_particles;
+	number_of_captured_particles += buffer.number_of_captured_particles;
+	weighted_free_particles += buffer.weighted_free_particles;
+	weighted_reflected_particles += buffer.weighted_reflected_particles;
+	weighted_captured_particles += buffer.weighted_captured_particles;
+	if(number_of_trajectories > 0)
+		average_number_of_scatterings = (number_of_trajectories_old * average_number_of_scatterings + buffer.number_of_scatterings) / number_of_trajectories;
+	for(unsigned int i = 0; i < 2 * isoreflection_rings; i++)
+		sample_weight_sums[i] += buffer.sample_weight_sums[i];
+	for(unsigned int i = 0; i < isoreflection_rings; i++)
+	{
+		data[i].insert(data[i].end(), buffer.data[i].begin(), buffer.data[i].end());
+		if(Streaming())
+			Merge_Histogram(histograms[i], buffer.histograms[i]);
+	}
+}
+
+void Simulation_Data::Check_Batch_Simulation() const
+{
+	if(batch_lanes > 0 && capture_short_circuit)
+	{
+		std::cerr << "Error in Simulation_Data::Generate_Data(): The batch simulation does not support the capture short-circuit." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	if(batch_lanes > 0 && optical_depth_sampling)
+	{
+		std::cerr << "Error in Simulation_Data::Generate_Data(): The batch simulation does not support the optical depth sampling." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	if(batch_lanes > 0 && diffusion_acceleration)
+	{
+		std::cerr << "Error in Simulation_Data::Generate_Data(): The batch simulation does not support the diffusion acceleration." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	if(batch_lanes > 0 && !splitting_speeds.empty())
+	{
+		std::cerr << "Error in Simulation_Data::Generate_Data(): The batch simulation does not split trajectories." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+void Simulation_Data::Generate_Data(obscura::DM_Particle& DM, const Solar_Model& solar_model, obscura::DM_Distribution& halo_model, unsigned int fixed_seed)
 {
 	auto time_start = std::chrono::system_clock::now();
 
+	// The processes either pass the data counters around in a ring, or sum them up regularly with non-blocking reductions.
+	bool ring_protocol = (termination_protocol == "Ring");
+
 	// MPI ring communication
 	int mpi_source		= (mpi_rank == 0) ? mpi_processes - 1 : mpi_rank - 1;
 	int mpi_destination = (mpi_rank == mpi_processes - 1) ? 0 : mpi_rank + 1;
@@ -41,62 +352,93 @@ void Simulation_Data::Generate_Data(obscura::DM_Particle& DM, Solar_Model& solar
 	MPI_Status mpi_status;
 	MPI_Request mpi_request;
 
-	// Configure the simulator
-	Trajectory_Simulator simulator(solar_model, maximum_free_time_steps, maximum_number_of_scatterings, initial_and_final_radius);
-	// simulator.Toggle_Trajectory_Saving(50);
+	// The weight sums, which determine the effective sample sizes, are passed around or reduced instead of counting the data points.
+	std::vector<double> global_sample_weight_sums(2 * isoreflection_rings, 0.0);
+	std::vector<double> local_sample_weight_sums(2 * isoreflection_rings, 0.0);
+	MPI_Request mpi_reduction_request;
+	bool reduction_active = false;
+
+	// All processes use the same seed, but different random number streams.
 	if(fixed_seed != 0)
-		simulator.Fix_PRNG_Seed(fixed_seed);
+		random_seed = fixed_seed;
+	else
+	{
+		std::random_device rd;
+		random_seed = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+		MPI_Bcast(&random_seed, 1, MPI_UINT64_T, 0, mpi_communicator);
+	}
+
+	// Configure one simulator per thread, which all share the solar model and the initial conditions' tables.
+	Check_Batch_Simulation();
+	std::vector<Trajectory_Simulator> simulators;
+	std::vector<Trajectory_Batch_Simulator> batch_simulators;
+	std::vector<Thread_Buffer> buffers(threads_per_process);
+	for(unsigned int thread = 0; thread < threads_per_process; thread++)
+	{
+		simulators.push_back(Trajectory_Simulator(solar_model, maximum_free_time_steps, maximum_number_of_scatterings, initial_and_final_radius));
+		simulators.back().splitting_speeds		 = splitting_speeds;
+		simulators.back().splitting_factor		 = splitting_factor;
+		simulators.back().capture_short_circuit	 = capture_short_circuit;
+		simulators.back().capture_collisions	 = capture_collisions;
+		simulators.back().optical_depth_sampling = optical_depth_sampling;
+		simulators.back().diffusion_acceleration = diffusion_acceleration;
+		if(batch_lanes > 0)
+			batch_simulators.push_back(Trajectory_Batch_Simulator(solar_model, batch_lanes, maximum_free_time_steps, maximum_number_of_scatterings, initial_and_final_radius));
+		// simulators.back().Toggle_Trajectory_Saving(50, 20, thread);
+		buffers[thread].data					  = std::vector<std::vector<libphysica::DataPoint>>(isoreflection_rings);
+		buffers[thread].histograms				  = std::vector<Speed_Histogram>(Streaming() ? isoreflection_rings : 0, Empty_Histogram());
+		buffers[thread].sample_weight_sums		  = std::vector<double>(2 * isoreflection_rings, 0.0);
+		buffers[thread].trajectory_sample_weights = std::vector<double>(isoreflection_rings, 0.0);
+	}
+	histograms = std::vector<Speed_Histogram>(Streaming() ? isoreflection_rings : 0, Empty_Histogram());
+	std::uint64_t first_stream = static_cast<std::uint64_t>(mpi_rank) * threads_per_process;
+
+	// Tabulate the initial conditions' distribution
+	Initial_Conditions_Generator initial_conditions_generator(halo_model, solar_model);
+	initial_conditions_generator.Set_Importance_Sampling(speed_bias_exponent, impact_parameter_bias);
+	auto simulate = [this, first_stream, &simulators, &batch_simulators, &initial_conditions_generator, &DM, &solar_model, &buffers](unsigned int thread, std::vector<std::atomic<double>>& local_counter_new) {
+		if(batch_simulators.empty())
+			Simulate_Trajectory(simulators[thread], initial_conditions_generator, DM, solar_model, first_stream + thread, buffers[thread], local_counter_new);
+		else
+			Simulate_Trajectory_Batch(batch_simulators[thread], initial_conditions_generator, DM, solar_model, first_stream + thread, buffers[thread], local_counter_new);
+	};
 
 	// Get the MPI ring communication started by sending the data counters
-	std::vector<unsigned long int> local_counter_new(isoreflection_rings, 0);
-	if(mpi_rank == 0)
-		MPI_Isend(&number_of_data_points.front(), isoreflection_rings, MPI_UNSIGNED_LONG, mpi_destination, mpi_tag, MPI_COMM_WORLD, &mpi_request);
+	std::vector<std::atomic<double>> local_counter_new(2 * isoreflection_rings);
+	for(auto& counter : local_counter_new)
+		counter = 0.0;
+	if(ring_protocol && mpi_rank == 0)
+		MPI_Isend(global_sample_weight_sums.data(), 2 * isoreflection_rings, MPI_DOUBLE, mpi_destination, mpi_tag, mpi_communicator, &mpi_request);
+
+	MPI_Barrier(mpi_communicator);
 
-	MPI_Barrier(MPI_COMM_WORLD);
-	unsigned int smallest_sample_size = 0;
+	// Additional threads simulate trajectories until the main thread, which handles all MPI communication, is done.
+	std::atomic<bool> simulation_finished(false);
+	std::vector<std::thread> workers;
+	for(unsigned int thread = 1; thread < threads_per_process; thread++)
+		workers.push_back(std::thread([thread, &simulate, &local_counter_new, &simulation_finished]() {
+			while(!simulation_finished)
+				simulate(thread, local_counter_new);
+		}));
+
+	double smallest_sample_size = 0.0;
 	while(smallest_sample_size < min_sample_size_above_threshold)
 	{
-		Event IC = Initial_Conditions(halo_model, solar_model, simulator.PRNG);
-		Hyperbolic_Kepler_Shift(IC, initial_and_final_radius);
-		Trajectory_Result trajectory = simulator.Simulate(IC, DM);
-
-		number_of_trajectories++;
-		average_number_of_scatterings = 1.0 / number_of_trajectories * ((number_of_trajectories - 1) * average_number_of_scatterings + trajectory.number_of_scatterings);
+		simulate(0, local_counter_new);
 
-		if(trajectory.Particle_Captured(solar_model))
-			number_of_captured_particles++;
-		else
+		if(ring_protocol)
 		{
-			if(trajectory.Particle_Free())
-				number_of_free_particles++;
-			else if(trajectory.Particle_Reflected())
-				number_of_reflected_particles++;
-			else
-				continue;
-
-			Hyperbolic_Kepler_Shift(trajectory.final_event, 1.0 * AU);
-			double v_final = trajectory.final_event.Speed();
-			if(trajectory.number_of_scatterings >= minimum_number_of_scatterings && v_final > KDE_boundary_correction_factor * minimum_speed_threshold)
-			{
-				unsigned int isoreflection_ring = (isoreflection_rings == 1) ? 0 : trajectory.final_event.Isoreflection_Ring(obscura::Sun_Velocity(), isoreflection_rings);
-				if(v_final > minimum_speed_threshold)
-					local_counter_new[isoreflection_ring]++;
-				data[isoreflection_ring].push_back(libphysica::DataPoint(v_final));
-			}
 			// Check if data counters arrived.
 			int mpi_flag;
-			MPI_Iprobe(mpi_source, MPI_ANY_TAG, MPI_COMM_WORLD, &mpi_flag, &mpi_status);
+			MPI_Iprobe(mpi_source, MPI_ANY_TAG, mpi_communicator, &mpi_flag, &mpi_status);
 			if(mpi_flag)
 			{
 				// Receive and increment the data counters
-				MPI_Recv(&number_of_data_points.front(), isoreflection_rings, MPI_UNSIGNED_LONG, mpi_source, MPI_ANY_TAG, MPI_COMM_WORLD, &mpi_status);
-				unsigned long int smallest_sample_size_old = *std::min_element(std::begin(number_of_data_points), std::end(number_of_data_points));
-				for(unsigned int i = 0; i < isoreflection_rings; i++)
-				{
-					number_of_data_points[i] += local_counter_new[i];
-					local_counter_new[i] = 0;
-				}
-				smallest_sample_size = *std::min_element(std::begin(number_of_data_points), std::end(number_of_data_points));
+				MPI_Recv(global_sample_weight_sums.data(), 2 * isoreflection_rings, MPI_DOUBLE, mpi_source, MPI_ANY_TAG, mpi_communicator, &mpi_status);
+				double smallest_sample_size_old = Smallest_Effective_Sample_Size(global_sample_weight_sums);
+				for(unsigned int i = 0; i < 2 * isoreflection_rings; i++)
+					global_sample_weight_sums[i] += local_counter_new[i].exchange(0.0);
+				smallest_sample_size = Smallest_Effective_Sample_Size(global_sample_weight_sums);
 				// Check if we are done
 				if(smallest_sample_size_old < min_sample_size_above_threshold && smallest_sample_size >= min_sample_size_above_threshold)
 					mpi_tag = mpi_source + 1;
@@ -104,51 +446,138 @@ void Simulation_Data::Generate_Data(obscura::DM_Particle& DM, Solar_Model& solar
 					mpi_tag = mpi_status.MPI_TAG;
 
 				// Progress bar
-				if(smallest_sample_size_old < smallest_sample_size && mpi_rank % 10 == 0)
+				if(print_progress && smallest_sample_size_old < smallest_sample_size && mpi_rank % 10 == 0)
 				{
 					double time = 1e-6 * std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - time_start).count();
 					libphysica::Print_Progress_Bar(1.0 * smallest_sample_size / min_sample_size_above_threshold, 0, 44, time);
 				}
 				// Pass on the counters, unless you are the very last process.
 				if(mpi_tag != (mpi_rank + 1))
-					MPI_Isend(&number_of_data_points.front(), isoreflection_rings, MPI_UNSIGNED_LONG, mpi_destination, mpi_tag, MPI_COMM_WORLD, &mpi_request);
+					MPI_Isend(global_sample_weight_sums.data(), 2 * isoreflection_rings, MPI_DOUBLE, mpi_destination, mpi_tag, mpi_communicator, &mpi_request);
+			}
+		}
+		else if(!reduction_active)
+		{
+			// Start a new reduction of the data counters, once the previous one is completed.
+			for(unsigned int i = 0; i < 2 * isoreflection_rings; i++)
+				local_sample_weight_sums[i] += local_counter_new[i].exchange(0.0);
+			MPI_Iallreduce(local_sample_weight_sums.data(), global_sample_weight_sums.data(), 2 * isoreflection_rings, MPI_DOUBLE, MPI_SUM, mpi_communicator, &mpi_reduction_request);
+			reduction_active = true;
+		}
+		else
+		{
+			// All processes evaluate the same reductions, and therefore stop after the same one.
+			int mpi_flag;
+			MPI_Test(&mpi_reduction_request, &mpi_flag, MPI_STATUS_IGNORE);
+			if(mpi_flag)
+			{
+				reduction_active				= false;
+				double smallest_sample_size_old = smallest_sample_size;
+				smallest_sample_size			= Smallest_Effective_Sample_Size(global_sample_weight_sums);
+
+				// Progress bar
+				if(print_progress && smallest_sample_size_old < smallest_sample_size && mpi_rank == 0)
+				{
+					double time = 1e-6 * std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - time_start).count();
+					libphysica::Print_Progress_Bar(1.0 * smallest_sample_size / min_sample_size_above_threshold, 0, 44, time);
+				}
 			}
 		}
 	}
+	simulation_finished = true;
+	for(auto& worker : workers)
+		worker.join();
+	for(auto& buffer : buffers)
+		Merge_Thread_Buffer(buffer);
+	for(auto& simulator : simulators)
+		number_of_short_circuited_particles += simulator.Short_Circuited_Trajectories();
+
 	auto time_end  = std::chrono::system_clock::now();
 	computing_time = 1e-6 * std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_start).count();
-	libphysica::Print_Progress_Bar(1.0, mpi_rank, 44, computing_time);
-	if(mpi_rank == 0)
+	if(print_progress && mpi_rank == 0)
+	{
+		libphysica::Print_Progress_Bar(1.0, mpi_rank, 44, computing_time);
 		std::cout << std::endl;
-	MPI_Barrier(MPI_COMM_WORLD);
-	Perform_MPI_Reductions();
+	}
+	MPI_Barrier(mpi_communicator);
+	if(Streaming())
+		Perform_MPI_Histogram_Reductions();
+	else
+		Perform_MPI_Reductions();
 }
 
-void Simulation_Data::Perform_MPI_Reductions()
+void Simulation_Data::Perform_MPI_Counter_Reductions()
 {
 	average_number_of_scatterings *= number_of_trajectories;
-	MPI_Allreduce(MPI_IN_PLACE, &number_of_trajectories, 1, MPI_UNSIGNED_LONG, MPI_SUM, MPI_COMM_WORLD);
-	MPI_Allreduce(MPI_IN_PLACE, &number_of_free_particles, 1, MPI_UNSIGNED_LONG, MPI_SUM, MPI_COMM_WORLD);
-	MPI_Allreduce(MPI_IN_PLACE, &number_of_reflected_particles, 1, MPI_UNSIGNED_LONG, MPI_SUM, MPI_COMM_WORLD);
-	MPI_Allreduce(MPI_IN_PLACE, &number_of_captured_particles, 1, MPI_UNSIGNED_LONG, MPI_SUM, MPI_COMM_WORLD);
-	MPI_Allreduce(MPI_IN_PLACE, &average_number_of_scatterings, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	MPI_Allreduce(MPI_IN_PLACE, &number_of_trajectories, 1, MPI_UNSIGNED_LONG, MPI_SUM, mpi_communicator);
+	MPI_Allreduce(MPI_IN_PLACE, &number_of_free_particles, 1, MPI_UNSIGNED_LONG, MPI_SUM, mpi_communicator);
+	MPI_Allreduce(MPI_IN_PLACE, &number_of_reflected_particles, 1, MPI_UNSIGNED_LONG, MPI_SUM, mpi_communicator);
+	MPI_Allreduce(MPI_IN_PLACE, &number_of_captured_particles, 1, MPI_UNSIGNED_LONG, MPI_SUM, mpi_communicator);
+	MPI_Allreduce(MPI_IN_PLACE, &number_of_short_circuited_particles, 1, MPI_UNSIGNED_LONG, MPI_SUM, mpi_communicator);
+	MPI_Allreduce(MPI_IN_PLACE, &weighted_free_particles, 1, MPI_DOUBLE, MPI_SUM, mpi_communicator);
+	MPI_Allreduce(MPI_IN_PLACE, &weighted_reflected_particles, 1, MPI_DOUBLE, MPI_SUM, mpi_communicator);
+	MPI_Allreduce(MPI_IN_PLACE, &weighted_captured_particles, 1, MPI_DOUBLE, MPI_SUM, mpi_communicator);
+	MPI_Allreduce(MPI_IN_PLACE, &average_number_of_scatterings, 1, MPI_DOUBLE, MPI_SUM, mpi_communicator);
 	average_number_of_scatterings /= number_of_trajectories;
+	MPI_Allreduce(MPI_IN_PLACE, &computing_time, 1, MPI_DOUBLE, MPI_MAX, mpi_communicator);
+}
 
+void Simulation_Data::Perform_MPI_Reductions()
+{
+	Perform_MPI_Counter_Reductions();
+
+	auto time_start = std::chrono::system_clock::now();
+
+	// 1. The sizes and weights of the rings are summed up by all processes, independently of where the data points end up.
+	std::vector<double> ring_sums(4 * isoreflection_rings, 0.0);
+	for(unsigned int i = 0; i < isoreflection_rings; i++)
+	{
+		ring_sums[4 * i] = data[i].size();
+		for(auto& data_point : data[i])
+			ring_sums[4 * i + 1] += data_point.weight;
+		ring_sums[4 * i + 2] = sample_weight_sums[2 * i];
+		ring_sums[4 * i + 3] = sample_weight_sums[2 * i + 1];
+	}
+	MPI_Allreduce(MPI_IN_PLACE, ring_sums.data(), ring_sums.size(), MPI_DOUBLE, MPI_SUM, mpi_communicator);
+	for(unsigned int i = 0; i < isoreflection_rings; i++)
+	{
+		number_of_data_points[i]	  = std::round(ring_sums[4 * i]);
+		weighted_data_points[i]		  = ring_sums[4 * i + 1];
+		sample_weight_sums[2 * i]	  = ring_sums[4 * i + 2];
+		sample_weight_sums[2 * i + 1] = ring_sums[4 * i + 3];
+	}
+	double smallest_sample_size = Smallest_Effective_Sample_Size(sample_weight_sums);
+
+	// 2. Collect the data points.
+	if(data_reduction == "MPI-IO")
+		Collect_Data_MPI_IO();
+	else
+		Collect_Data(data_reduction == "Allgather");
+	MPI_Barrier(mpi_communicator);
+	reduction_time = 1e-6 * std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - time_start).count();
+
+	// Estimate the number of trajectories simulated in excess of the required sample size.
+	overshoot_trajectories = (smallest_sample_size > min_sample_size_above_threshold) ? std::round(number_of_trajectories * (1.0 - 1.0 * min_sample_size_above_threshold / smallest_sample_size)) : 0;
+}
+
+void Simulation_Data::Collect_Data(bool all_processes)
+{
 	MPI_Datatype mpi_datapoint;
 	MPI_Type_contiguous(2, MPI_DOUBLE, &mpi_datapoint);
 	MPI_Type_commit(&mpi_datapoint);
-	std::vector<std::vector<libphysica::DataPoint>> global_data;
+	std::vector<std::vector<libphysica::DataPoint>> global_data(isoreflection_rings);
 	for(unsigned int i = 0; i < isoreflection_rings; i++)
 	{
 		// 1. How many data points did this worker gather?
 		unsigned long int local_number_of_data_points = data[i].size();
-		// 2. Every worker needs to know how much every worker did.
+		// 2. Every worker, or only the root, needs to know how much every worker did.
 		std::vector<unsigned long int> data_points_of_workers(mpi_processes);
-		MPI_Allgather(&local_number_of_data_points, 1, MPI_UNSIGNED_LONG, data_points_of_workers.data(), 1, MPI_UNSIGNED_LONG, MPI_COMM_WORLD);
-		// 3. How many data points did all workers gather in total?
-		number_of_data_points[i] = std::accumulate(data_points_of_workers.begin(), data_points_of_workers.end(), 0);
+		if(all_processes)
+			MPI_Allgather(&local_number_of_data_points, 1, MPI_UNSIGNED_LONG, data_points_of_workers.data(), 1, MPI_UNSIGNED_LONG, mpi_communicator);
+		else
+			MPI_Gather(&local_number_of_data_points, 1, MPI_UNSIGNED_LONG, data_points_of_workers.data(), 1, MPI_UNSIGNED_LONG, 0, mpi_communicator);
 
-		// 4. Collect info on the data packages to be received.
+		// 3. Collect info on the data packages to be received.
 		std::vector<int> receive_counter(mpi_processes);
 		std::vector<int> receive_displacements(mpi_processes);
 		for(int j = 0; j < mpi_processes; j++)
@@ -156,29 +585,157 @@ void Simulation_Data::Perform_MPI_Reductions()
 			receive_counter[j]		 = data_points_of_workers[j];
 			receive_displacements[j] = (j == 0) ? 0 : receive_displacements[j - 1] + data_points_of_workers[j - 1];
 		}
-		// 5. Gather data packages
-		std::vector<libphysica::DataPoint> ring_data(number_of_data_points[i]);
-		MPI_Allgatherv(&data[i].front(), local_number_of_data_points, mpi_datapoint, &ring_data.front(), receive_counter.data(), receive_displacements.data(), mpi_datapoint, MPI_COMM_WORLD);
-		global_data.push_back(ring_data);
+		// 4. Gather data packages
+		if(all_processes || mpi_rank == 0)
+			global_data[i].resize(number_of_data_points[i]);
+		if(all_processes)
+			MPI_Allgatherv(data[i].data(), local_number_of_data_points, mpi_datapoint, global_data[i].data(), receive_counter.data(), receive_displacements.data(), mpi_datapoint, mpi_communicator);
+		else
+			MPI_Gatherv(data[i].data(), local_number_of_data_points, mpi_datapoint, global_data[i].data(), receive_counter.data(), receive_displacements.data(), mpi_datapoint, 0, mpi_communicator);
 	}
+	MPI_Type_free(&mpi_datapoint);
 	data = global_data;
-	MPI_Allreduce(MPI_IN_PLACE, &computing_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
 }
 
+void Simulation_Data::Collect_Data_MPI_IO()
+{
+	MPI_Datatype mpi_datapoint;
+	MPI_Type_contiguous(2, MPI_DOUBLE, &mpi_datapoint);
+	MPI_Type_commit(&mpi_datapoint);
+
+	// 1. Every process writes its slices of the rings with one collective call per ring. The rings are stored one after the other.
+	std::vector<unsigned long int> local_number_of_data_points(isoreflection_rings), offsets(isoreflection_rings, 0);
+	for(unsigned int i = 0; i < isoreflection_rings; i++)
+		local_number_of_data_points[i] = data[i].size();
+	MPI_Exscan(local_number_of_data_points.data(), offsets.data(), isoreflection_rings, MPI_UNSIGNED_LONG, MPI_SUM, mpi_communicator);
+	if(mpi_rank == 0)
+		std::fill(offsets.begin(), offsets.end(), 0);
+
+	MPI_File file;
+	if(MPI_File_open(mpi_communicator, data_reduction_file.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+	{
+		std::cerr << "Error in Simulation_Data::Collect_Data_MPI_IO(): File " << data_reduction_file << " could not be opened." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	MPI_File_set_size(file, 0);
+	unsigned long int ring_offset = 0;
+	for(unsigned int i = 0; i < isoreflection_rings; i++)
+	{
+		MPI_Offset offset = (ring_offset + offsets[i]) * sizeof(libphysica::DataPoint);
+		MPI_File_write_at_all(file, offset, data[i].data(), local_number_of_data_points[i], mpi_datapoint, MPI_STATUS_IGNORE);
+		ring_offset += number_of_data_points[i];
+	}
+	MPI_File_close(&file);
+
+	// 2. The root reads the complete data set, and deletes the file.
+	for(auto& ring_data : data)
+		ring_data.clear();
+	if(mpi_rank == 0)
+	{
+		MPI_File_open(MPI_COMM_SELF, data_reduction_file.c_str(), MPI_MODE_RDONLY | MPI_MODE_DELETE_ON_CLOSE, MPI_INFO_NULL, &file);
+		ring_offset = 0;
+		for(unsigned int i = 0; i < isoreflection_rings; i++)
+		{
+			data[i].resize(number_of_data_points[i]);
+			MPI_File_read_at(file, ring_offset * sizeof(libphysica::DataPoint), data[i].data(), number_of_data_points[i], mpi_datapoint, MPI_STATUS_IGNORE);
+			ring_offset += number_of_data_points[i];
+		}
+		MPI_File_close(&file);
+	}
+	MPI_Type_free(&mpi_datapoint);
+}
+
+void Simulation_Data::Perform_MPI_Histogram_Reductions()
+{
+	Perform_MPI_Counter_Reductions();
+	auto time_start = std::chrono::system_clock::now();
+
+	// 1. All sums of all rings are packed into one buffer and reduced at once.
+	// All processes need the histograms for the spectra, so it is an allreduce instead of a reduction to process 0.
+	std::vector<double> sums = sample_weight_sums;
+	std::vector<double> extremes;
+	for(auto& histogram : histograms)
+	{
+		sums.insert(sums.end(), histogram.weights.begin(), histogram.weights.end());
+		sums.insert(sums.end(), {histogram.overflow_weight, histogram.data_points, histogram.weight_sum, histogram.weight_squared_sum, histogram.weighted_speed_sum, histogram.weighted_speed_squared_sum});
+		extremes.insert(extremes.end(), {-histogram.lowest_speed, histogram.highest_speed});
+	}
+	MPI_Allreduce(MPI_IN_PLACE, sums.data(), sums.size(), MPI_DOUBLE, MPI_SUM, mpi_communicator);
+	MPI_Allreduce(MPI_IN_PLACE, extremes.data(), extremes.size(), MPI_DOUBLE, MPI_MAX, mpi_communicator);
+
+	// 2. Unpack
+	auto sum = sums.begin();
+	std::copy(sum, sum + 2 * isoreflection_rings, sample_weight_sums.begin());
+	sum += 2 * isoreflection_rings;
+	for(unsigned int i = 0; i < isoreflection_rings; i++)
+	{
+		Speed_Histogram& histogram = histograms[i];
+		std::copy(sum, sum + histogram_bins, histogram.weights.begin());
+		sum += histogram_bins;
+		histogram.overflow_weight			 = *sum++;
+		histogram.data_points				 = *sum++;
+		histogram.weight_sum				 = *sum++;
+		histogram.weight_squared_sum		 = *sum++;
+		histogram.weighted_speed_sum		 = *sum++;
+		histogram.weighted_speed_squared_sum = *sum++;
+		histogram.lowest_speed				 = -extremes[2 * i];
+		histogram.highest_speed				 = extremes[2 * i + 1];
+		number_of_data_points[i]			 = std::round(histogram.data_points);
+		weighted_data_points[i]				 = histogram.weight_sum;
+
+		// 3. The bin centers replace the data points. The spectra are smoothed from the bins themselves, see Histogram_Weights().
+		double bin_width = Histogram_Bin_Width();
+		data[i].clear();
+		for(unsigned int bin = 0; bin < histogram_bins; bin++)
+			if(histogram.weights[bin] > 0.0)
+				data[i].push_back(libphysica::DataPoint(Minimum_Speed() + (bin + 0.5) * bin_width, histogram.weights[bin]));
+	}
+
+	double smallest_sample_size = Smallest_Effective_Sample_Size(sample_weight_sums);
+	overshoot_trajectories = (smallest_sample_size > min_sample_size_above_threshold) ? std::round(number_of_trajectories * (1.0 - 1.0 * min_sample_size_above_threshold / smallest_sample_size)) : 0;
+	reduction_time		   = 1e-6 * std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - time_start).count();
+}
+
+// With importance sampling, the ratios are the weighted counts over the number of trajectories, whose expected weight is one.
 double Simulation_Data::Free_Ratio() const
 {
-	return 1.0 * number_of_free_particles / number_of_trajectories;
+	return weighted_free_particles / number_of_trajectories;
 }
 double Simulation_Data::Capture_Ratio() const
 {
-	return 1.0 * number_of_captured_particles / number_of_trajectories;
+	return weighted_captured_particles / number_of_trajectories;
 }
 double Simulation_Data::Reflection_Ratio(int isoreflection_ring) const
 {
 	if(isoreflection_ring < 0)
-		return 1.0 * number_of_reflected_particles / number_of_trajectories;
+		return weighted_reflected_particles / number_of_trajectories;
 	else
-		return 1.0 * data[isoreflection_ring].size() / number_of_trajectories;
+		return weighted_data_points[isoreflection_ring] / number_of_trajectories;
+}
+
+unsigned long int Simulation_Data::Overshoot_Trajectories() const
+{
+	return overshoot_trajectories;
+}
+
+double Simulation_Data::Effective_Sample_Size(unsigned int iso_ring) const
+{
+	double sum_weights	   = sample_weight_sums[2 * iso_ring];
+	double sum_weights_sqr = sample_weight_sums[2 * iso_ring + 1];
+	return (sum_weights_sqr > 0.0) ? sum_weights * sum_weights / sum_weights_sqr : 0.0;
+}
+
+double Simulation_Data::Smallest_Effective_Sample_Size(const std::vector<double>& weight_sums) const
+{
+	double smallest_sample_size = std::numeric_limits<double>::infinity();
+	for(unsigned int i = 0; i < isoreflection_rings; i++)
+		smallest_sample_size = std::min(smallest_sample_size, (weight_sums[2 * i + 1] > 0.0) ? weight_sums[2 * i] * weight_sums[2 * i] / weight_sums[2 * i + 1] : 0.0);
+	return smallest_sample_size;
+}
+
+std::uint64_t Simulation_Data::Random_Seed() const
+{
+	return random_seed;
 }
 
 double Simulation_Data::Minimum_Speed() const
@@ -188,14 +745,62 @@ double Simulation_Data::Minimum_Speed() const
 
 double Simulation_Data::Lowest_Speed(unsigned int iso_ring) const
 {
+	if(Streaming())
+		return histograms[iso_ring].lowest_speed;
 	return (*std::min_element(data[iso_ring].begin(), data[iso_ring].end())).value;
 }
 
 double Simulation_Data::Highest_Speed(unsigned int iso_ring) const
 {
+	if(Streaming())
+		return histograms[iso_ring].highest_speed;
 	return (*std::max_element(data[iso_ring].begin(), data[iso_ring].end())).value;
 }
 
+double Simulation_Data::KDE_Bandwidth(unsigned int iso_ring) const
+{
+	if(!Streaming() || histograms[iso_ring].weight_sum <= 0.0)
+		return 0.0;
+	const Speed_Histogram& histogram = histograms[iso_ring];
+	double mean						 = histogram.weighted_speed_sum / histogram.weight_sum;
+	double variance					 = std::max(histogram.weighted_speed_squared_sum / histogram.weight_sum - mean * mean, 0.0);
+	double effective_sample_size	 = histogram.weight_sum * histogram.weight_sum / histogram.weight_squared_sum;
+	return std::pow(4.0 / 3.0 / effective_sample_size, 0.2) * std::sqrt(variance);
+}
+
+const std::vector<double>& Simulation_Data::Histogram_Weights(unsigned int iso_ring) const
+{
+	if(!Streaming())
+	{
+		std::cerr << "Error in Simulation_Data::Histogram_Weights(): The histograms are only filled in streaming mode." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	return histograms[iso_ring].weights;
+}
+
+double Simulation_Data::Histogram_Bin_Width() const
+{
+	return (histogram_maximum_speed - Minimum_Speed()) / histogram_bins;
+}
+
+double Simulation_Data::Histogram_Overflow(unsigned int iso_ring) const
+{
+	if(!Streaming() || histograms[iso_ring].weight_sum <= 0.0)
+		return 0.0;
+	return histograms[iso_ring].overflow_weight / histograms[iso_ring].weight_sum;
+}
+
+std::vector<double> Simulation_Data::Average_Speed(unsigned int iso_ring)
+{
+	if(!Streaming())
+		return libphysica::Weighted_Average(data[iso_ring]);
+	const Speed_Histogram& histogram = histograms[iso_ring];
+	double mean						 = histogram.weighted_speed_sum / histogram.weight_sum;
+	double variance					 = std::max(histogram.weighted_speed_squared_sum / histogram.weight_sum - mean * mean, 0.0);
+	double effective_sample_size	 = histogram.weight_sum * histogram.weight_sum / histogram.weight_squared_sum;
+	return {mean, std::sqrt(variance / effective_sample_size)};
+}
+
 void Simulation_Data::Print_Summary(unsigned int mpi_rank)
 {
 	if(mpi_rank == 0)
@@ -208,14 +813,34 @@ void Simulation_Data::Print_Summary(unsigned int mpi_rank)
 				  << "DM speed threshold [km/sec]:\t" << libphysica::Round(In_Units(minimum_speed_threshold, km / sec)) << std::endl
 				  << "Minimum sample size:\t\t" << min_sample_size_above_threshold << std::endl
 				  << "Isoreflection rings:\t\t" << isoreflection_rings << std::endl
+				  << "Termination protocol:\t\t" << termination_protocol << std::endl
+				  << "Data reduction:\t\t\t" << (Streaming() ? "Histograms" : data_reduction) << std::endl
+				  << "Random seed:\t\t\t" << random_seed << std::endl
+				  << "Importance sampling:\t\t[" << ((speed_bias_exponent != 0.0 || impact_parameter_bias != 1.0) ? "x" : " ") << "]" << std::endl
+				  << "Streaming histograms:\t\t" << (Streaming() ? "[x] (" + std::to_string(histogram_bins) + " bins up to " + std::to_string((int) std::round(In_Units(histogram_maximum_speed, km / sec))) + " km/sec)" : "[ ]") << std::endl
+				  << "Capture short-circuit:\t\t" << (capture_short_circuit ? "[x] (" + std::to_string(capture_collisions) + " collisions)" : "[ ]") << std::endl
+				  << "Optical depth sampling:\t\t[" << (optical_depth_sampling ? "x" : " ") << "]" << std::endl
+				  << "Diffusion acceleration:\t\t[" << (diffusion_acceleration ? "x" : " ") << "]" << std::endl
 				  << std::endl
 				  << "Results:" << std::endl
 				  << "Simulated trajectories:\t\t" << number_of_trajectories << std::endl
+				  << "Overshoot (trajectories):\t" << overshoot_trajectories << " (" << libphysica::Round(100.0 * overshoot_trajectories / number_of_trajectories) << "%)" << std::endl
 				  << "Generated data points (total):\t" << number_of_data_points_tot << std::endl
 				  << "Average # of scatterings:\t" << libphysica::Round(average_number_of_scatterings) << std::endl
 				  << "Free particles [%]:\t\t" << libphysica::Round(100.0 * Free_Ratio()) << std::endl
 				  << "Reflected particles [%]:\t" << libphysica::Round(100.0 * Reflection_Ratio()) << std::endl
 				  << "Captured particles [%]:\t\t" << libphysica::Round(100.0 * Capture_Ratio()) << std::endl;
+		if(capture_short_circuit)
+			std::cout << "Captured early (cut short):\t" << number_of_short_circuited_particles << std::endl;
+		if(Streaming())
+		{
+			double overflow_weight = 0.0;
+			for(auto& histogram : histograms)
+				overflow_weight += histogram.overflow_weight;
+			double weight_sum = std::accumulate(weighted_data_points.begin(), weighted_data_points.end(), 0.0);
+			if(overflow_weight > 0.0)
+				std::cout << "Histogram overflow [%]:\t\t" << libphysica::Round(100.0 * overflow_weight / weight_sum) << " (not binned, increase the maximum speed)" << std::endl;
+		}
 
 		if(isoreflection_rings > 1)
 		{
@@ -224,22 +849,29 @@ void Simulation_Data::Print_Summary(unsigned int mpi_rank)
 			for(unsigned int i = 0; i < isoreflection_rings; i++)
 			{
 				double rel_number_of_data_points = 100.0 * number_of_data_points[i] / number_of_data_points_tot;
-				std::vector<double> u_average	 = libphysica::Weighted_Average(data[i]);
+				std::vector<double> u_average	 = Average_Speed(i);
 				double u_max					 = Highest_Speed(i);
 				std::cout << i + 1 << "\t" << number_of_data_points[i] << "\t\t" << libphysica::Round(rel_number_of_data_points) << "\t\t" << libphysica::Round(In_Units(u_average[0], km / sec)) << " +- " << libphysica::Round(In_Units(u_average[1], km / sec)) << "\t" << libphysica::Round(In_Units(u_max, km / sec)) << std::endl;
 			}
 		}
 		else
 		{
-			std::vector<double> u_average = libphysica::Weighted_Average(data[0]);
+			std::vector<double> u_average = Average_Speed(0);
 			double u_max				  = Highest_Speed();
 			std::cout << "<u> [km/sec]:\t\t\t" << libphysica::Round(In_Units(u_average[0], km / sec)) << " +- " << libphysica::Round(In_Units(u_average[1], km / sec)) << std::endl
 					  << "u_max [km/sec]:\t\t\t" << libphysica::Round(In_Units(u_max, km / sec)) << std::endl;
 		}
+		double effective_sample_size = 0.0;
+		for(unsigned int i = 0; i < isoreflection_rings; i++)
+			effective_sample_size += Effective_Sample_Size(i);
+		double cpu_time = computing_time * mpi_processes * threads_per_process;
 		std::cout << std::endl
+				  << "Effective sample size:\t\t" << libphysica::Round(effective_sample_size) << std::endl
+				  << "Effective samples per CPU-s:\t" << libphysica::Round(effective_sample_size / cpu_time) << std::endl
 				  << "Trajectory rate [1/s]:\t\t" << libphysica::Round(1.0 * number_of_trajectories / computing_time) << std::endl
 				  << "Data generation rate [1/s]:\t" << libphysica::Round(1.0 * number_of_data_points_tot / computing_time) << std::endl
-				  << "Simulation time:\t\t" << libphysica::Time_Display(computing_time) << std::endl;
+				  << "Simulation time:\t\t" << libphysica::Time_Display(computing_time) << std::endl
+				  << "Data reduction time [s]:\t" << libphysica::Round(reduction_time) << std::endl;
 
 		std::cout << SEPARATOR << std::endl;
 	}
@@ -87,6 +87,154 @@ void Configuration::Import_Parameter_Scan_Parameter()
 		std::exit(EXIT_FAILURE);
 	}
 	try
+	{
+		interpolation_accuracy = config.lookup("interpolation_accuracy");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		interpolation_accuracy = 0.0;
+	}
+	try
+	{
+		threads_per_process = config.lookup("threads_per_process");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		threads_per_process = 1;
+	}
+	try
+	{
+		termination_protocol = config.lookup("termination_protocol").c_str();
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		termination_protocol = "Ring";
+	}
+	try
+	{
+		data_reduction = config.lookup("data_reduction").c_str();
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		data_reduction = "Allgather";
+	}
+	try
+	{
+		importance_sampling_speed_exponent = config.lookup("importance_sampling_speed_exponent");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		importance_sampling_speed_exponent = 0.0;
+	}
+	try
+	{
+		importance_sampling_impact_parameter_exponent = config.lookup("importance_sampling_impact_parameter_exponent");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		importance_sampling_impact_parameter_exponent = 1.0;
+	}
+	try
+	{
+		libconfig::Setting& speeds = config.lookup("splitting_speeds");
+		for(int i = 0; i < speeds.getLength(); i++)
+			splitting_speeds.push_back(static_cast<double>(speeds[i]) * km / sec);
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		splitting_speeds = {};
+	}
+	try
+	{
+		splitting_factor = config.lookup("splitting_factor");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		splitting_factor = 2;
+	}
+	try
+	{
+		batch_lanes = config.lookup("batch_lanes");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		batch_lanes = 0;
+	}
+	try
+	{
+		histogram_bins = config.lookup("histogram_bins");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		histogram_bins = 0;
+	}
+	try
+	{
+		histogram_maximum_speed = config.lookup("histogram_maximum_speed");
+		histogram_maximum_speed *= km / sec;
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		histogram_maximum_speed = 0.02;
+	}
+	try
+	{
+		capture_short_circuit = config.lookup("capture_short_circuit");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		capture_short_circuit = false;
+	}
+	try
+	{
+		capture_collisions = config.lookup("capture_collisions");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		capture_collisions = 10;
+	}
+	try
+	{
+		optical_depth_sampling = config.lookup("optical_depth_sampling");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		optical_depth_sampling = false;
+	}
+	try
+	{
+		diffusion_acceleration = config.lookup("diffusion_acceleration");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		diffusion_acceleration = false;
+	}
+	try
+	{
+		binned_KDE = config.lookup("binned_KDE");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		binned_KDE = false;
+	}
+	try
+	{
+		bool rate_table_cache	   = config.lookup("rate_table_cache");
+		rate_table_cache_directory = rate_table_cache ? results_path : "";
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		rate_table_cache_directory = "";
+	}
+	try
+	{
+		scan_process_groups = config.lookup("scan_process_groups");
+	}
+	catch(const SettingNotFoundException& nfex)
+	{
+		scan_process_groups = 1;
+	}
+	try
 	{
 		cross_section_min = config.lookup("cross_section_min");
 		cross_section_min *= cm * cm;
@@ -268,37 +416,169 @@ void Configuration::Print_Summary(int mpi_rank)
 				  << std::endl
 				  << "\tRun mode:\t\t\t" << run_mode << std::endl
 				  << "\tSample size:\t\t\t" << sample_size << std::endl
+				  << "\tThreads per MPI process:\t" << threads_per_process << std::endl
+				  << "\tTermination protocol:\t\t" << termination_protocol << std::endl
+				  << "\tData reduction:\t\t\t" << data_reduction << std::endl
 				  << "\tSc. rate interpolation:\t\t" << ((interpolation_points > 0) ? "[x] (Grid: " + std::to_string(interpolation_points) + "×" + std::to_string(interpolation_points) + ")" : "[ ]") << std::endl;
+		if(interpolation_points > 0 && interpolation_accuracy > 0.0)
+			std::cout << "\tAdaptive grid (rel. accuracy):\t" << libphysica::Round(interpolation_accuracy) << std::endl;
+		if(importance_sampling_speed_exponent != 0.0 || importance_sampling_impact_parameter_exponent != 1.0)
+			std::cout << "\tImportance sampling exponents:\t" << libphysica::Round(importance_sampling_speed_exponent) << " (speed), " << libphysica::Round(importance_sampling_impact_parameter_exponent) << " (impact parameter)" << std::endl;
+		if(!splitting_speeds.empty())
+		{
+			std::cout << "\tSplitting speeds [km/sec]:\t";
+			for(auto& speed : splitting_speeds)
+				std::cout << libphysica::Round(In_Units(speed, km / sec)) << " ";
+			std::cout << "(factor " << splitting_factor << ")" << std::endl;
+		}
+		if(batch_lanes > 0)
+			std::cout << "\tBatch simulation lanes:\t\t" << batch_lanes << std::endl;
+		if(histogram_bins > 0)
+			std::cout << "\tStreaming histograms:\t\t" << histogram_bins << " bins up to " << libphysica::Round(In_Units(histogram_maximum_speed, km / sec)) << " km/sec" << std::endl;
+		if(capture_short_circuit)
+			std::cout << "\tCapture short-circuit:\t\t" << capture_collisions << " collisions" << std::endl;
+		if(optical_depth_sampling)
+			std::cout << "\tOptical depth sampling:\t\t[x]" << std::endl;
+		if(diffusion_acceleration)
+			std::cout << "\tDiffusion acceleration:\t\t[x]" << std::endl;
+		if(binned_KDE)
+			std::cout << "\tBinned KDE:\t\t\t[x]" << std::endl;
+		if(!rate_table_cache_directory.empty())
+			std::cout << "\tRate table cache:\t\t" << rate_table_cache_directory << std::endl;
 		if(run_mode == "Parameter point" && isoreflection_rings > 1)
 			std::cout << "\tIsoreflection rings:\t\t" << isoreflection_rings << std::endl;
 		else if(run_mode == "Parameter scan")
 			std::cout
 				<< "\tCross section (min) [cm^2]:\t" << libphysica::Round(In_Units(cross_section_min, cm * cm)) << std::endl
 				<< "\tCross section (max) [cm^2]:\t" << libphysica::Round(In_Units(cross_section_max, cm * cm)) << std::endl
-				<< "\tCross section steps:\t\t" << cross_sections << std::endl;
+				<< "\tCross section steps:\t\t" << cross_sections << std::endl
+				<< "\tScan process groups:\t\t" << scan_process_groups << std::endl;
 		std::cout << SEPARATOR << std::endl;
 	}
 }
 
-double Compute_p_Value(unsigned int sample_size, obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, unsigned int rate_interpolation_points, int mpi_rank)
+void Configure_Simulation_Data(Simulation_Data& data_set, const Simulation_Settings& settings, const std::string& reduction_file)
+{
+	data_set.Set_Number_Of_Threads(settings.threads_per_process);
+	data_set.Set_Termination_Protocol(settings.termination_protocol);
+	data_set.Set_Data_Reduction(settings.data_reduction, reduction_file);
+	data_set.Set_Importance_Sampling(settings.importance_sampling_speed_exponent, settings.importance_sampling_impact_parameter_exponent);
+	data_set.Set_Splitting(settings.splitting_speeds, settings.splitting_factor);
+	data_set.Set_Batch_Simulation(settings.batch_lanes);
+	data_set.Set_Streaming_Histograms(settings.histogram_bins, settings.histogram_maximum_speed);
+	data_set.Set_Capture_Short_Circuit(settings.capture_short_circuit, settings.capture_collisions);
+	data_set.Set_Optical_Depth_Sampling(settings.optical_depth_sampling);
+	data_set.Set_Diffusion_Acceleration(settings.diffusion_acceleration);
+}
+
+double Compute_p_Value(obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, const Simulation_Settings& settings, bool verbose, MPI_Comm mpi_communicator)
 {
 	double u_min = detector.Minimum_DM_Speed(DM);
 
-	solar_model.Interpolate_Total_DM_Scattering_Rate(DM, rate_interpolation_points, rate_interpolation_points);
-	Simulation_Data data_set(sample_size, u_min);
+	// Groups of processes evaluating different parameter points need their own temporary files, labelled by the world rank of the group's root.
+	std::string reduction_file = TOP_LEVEL_DIR "results/Reflection_Data.bin";
+	if(mpi_communicator != MPI_COMM_WORLD)
+	{
+		int mpi_world_rank;
+		MPI_Comm_rank(MPI_COMM_WORLD, &mpi_world_rank);
+		MPI_Bcast(&mpi_world_rank, 1, MPI_INT, 0, mpi_communicator);
+		reduction_file = TOP_LEVEL_DIR "results/Reflection_Data_" + std::to_string(mpi_world_rank) + ".bin";
+	}
+
+	// Cached rate tables are shared by all cross sections of one DM mass and by repeated scans.
+	solar_model.Set_MPI_Communicator(mpi_communicator);
+	solar_model.Use_Rate_Table_Cache(settings.rate_table_cache_directory);
+	if(settings.interpolation_points > 0 && settings.interpolation_accuracy > 0.0)
+		solar_model.Interpolate_Total_DM_Scattering_Rate_Adaptive(DM, settings.interpolation_accuracy, settings.interpolation_points);
+	else
+		solar_model.Interpolate_Total_DM_Scattering_Rate(DM, settings.interpolation_points, settings.interpolation_points);
+	solar_model.Set_MPI_Communicator(MPI_COMM_WORLD);
+	Simulation_Data data_set(settings.sample_size, u_min);
+	data_set.Set_MPI_Communicator(mpi_communicator);
+	Configure_Simulation_Data(data_set, settings, reduction_file);
 	data_set.Generate_Data(DM, solar_model, halo_model);
-	data_set.Print_Summary(mpi_rank);
-	Reflection_Spectrum spectrum(data_set, solar_model, halo_model, DM.mass);
-	double p = detector.P_Value(DM, spectrum);
+	if(verbose)
+	{
+		int mpi_rank;
+		MPI_Comm_rank(mpi_communicator, &mpi_rank);
+		data_set.Print_Summary(mpi_rank);
+	}
+
+	// Without the complete data set on every process, process 0 computes the p value and shares it.
+	double p = 0.0;
+	if(data_set.Data_Available())
+	{
+		Reflection_Spectrum spectrum(data_set, solar_model, halo_model, DM.mass, 0, settings.binned_KDE);
+		p = detector.P_Value(DM, spectrum);
+	}
+	MPI_Bcast(&p, 1, MPI_DOUBLE, 0, mpi_communicator);
 	return (p < 1.0e-100) ? 0.0 : p;
 }
 
+Full_Scan_Queue::Full_Scan_Queue(std::vector<std::vector<double>>& grid, double p_crit)
+: p_value_grid(grid), p_critical(p_crit), pending_points(grid.size(), 0), next_point(0), row_check(grid.size() - 1), finished(false)
+{
+	for(int row = p_value_grid.size() - 1; row >= 0; row--)
+		for(int column = p_value_grid[row].size() - 1; column >= 0; column--)
+			if(p_value_grid[row][column] < 0.0)
+			{
+				points.push_back({row, column});
+				pending_points[row]++;
+			}
+	// Imported p values can finish the scan right away.
+	Check_Rows();
+}
+
+void Full_Scan_Queue::Check_Rows()
+{
+	while(!finished && row_check >= 0 && pending_points[row_check] == 0)
+	{
+		if(std::none_of(p_value_grid[row_check].begin(), p_value_grid[row_check].end(), [this](double p) { return p >= 0.0 && p < p_critical; }))
+			finished = true;
+		else
+			row_check--;
+	}
+}
+
+std::vector<int> Full_Scan_Queue::Next_Point()
+{
+	if(finished || next_point >= points.size())
+		return {-1, -1};
+	return points[next_point++];
+}
+
+void Full_Scan_Queue::Add_Result(int row, int column, double p)
+{
+	p_value_grid[row][column] = p;
+	pending_points[row]--;
+	Check_Rows();
+}
+
+bool Full_Scan_Queue::Finished() const
+{
+	return finished;
+}
+
+void Full_Scan_Queue::Fill_Remaining_Rows()
+{
+	if(finished)
+		for(int row = 0; row < row_check; row++)
+			for(auto& p : p_value_grid[row])
+				if(p < 0.0)
+					p = 1.0;
+}
+
 // 2. 	Class to perform parameter scans in the (m_DM, sigma)-plane to search for equal-p-value contours.
-Parameter_Scan::Parameter_Scan(const std::vector<double>& masses, const std::vector<double>& coupl, std::string ID, unsigned int samplesize, unsigned int interpolation_points, double CL)
-: DM_masses(masses), couplings(coupl), sample_size(samplesize), scattering_rate_interpolation_points(interpolation_points), certainty_level(CL)
+Parameter_Scan::Parameter_Scan(const std::vector<double>& masses, const std::vector<double>& coupl, std::string ID, unsigned int samplesize, unsigned int interpolation_points, double CL, unsigned int threads, std::string protocol, std::string reduction, unsigned int groups)
+: DM_masses(masses), couplings(coupl), process_groups(std::max(groups, 1u)), speculative_evaluations(0), wasted_evaluations(0), certainty_level(CL)
 {
-	results_path = TOP_LEVEL_DIR "results/" + ID + "/";
-	p_value_grid = std::vector<std::vector<double>>(couplings.size(), std::vector<double>(DM_masses.size(), -1.0));
+	settings.sample_size		  = samplesize;
+	settings.interpolation_points = interpolation_points;
+	settings.threads_per_process  = threads;
+	settings.termination_protocol = protocol;
+	settings.data_reduction		  = reduction;
+	results_path				  = TOP_LEVEL_DIR "results/" + ID + "/";
+	p_value_grid				  = std::vector<std::vector<double>>(couplings.size(), std::vector<double>(DM_masses.size(), -1.0));
 
 	// Try to import previous results from an incomplete run
 	Import_P_Values();
@@ -308,8 +588,9 @@ Parameter_Scan::Parameter_Scan(const std::vector<double>& masses, const std::vec
 }
 
 Parameter_Scan::Parameter_Scan(Configuration& config)
-: Parameter_Scan(libphysica::Log_Space(config.constraints_mass_min, config.constraints_mass_max, config.constraints_masses), libphysica::Log_Space(config.cross_section_min, config.cross_section_max, config.cross_sections), config.ID, config.sample_size, config.interpolation_points, config.constraints_certainty)
+: Parameter_Scan(libphysica::Log_Space(config.constraints_mass_min, config.constraints_mass_max, config.constraints_masses), libphysica::Log_Space(config.cross_section_min, config.cross_section_max, config.cross_sections), config.ID, config.sample_size, config.interpolation_points, config.constraints_certainty, config.threads_per_process, config.termination_protocol, config.data_reduction, config.scan_process_groups)
 {
+	settings = config;
 }
 
 void Parameter_Scan::Import_P_Values()
@@ -485,12 +766,113 @@ std::vector<std::vector<double>> Parameter_Scan::Limit_Curve()
 	return limit_curve;
 }
 
+std::vector<std::vector<int>> Parameter_Scan::STA_Frontier(int row, int column, const std::string& STA_direction, bool first_excluded_point_found, unsigned int max_points)
+{
+	// The STA path branches at every point with unknown p value, depending on whether the point gets excluded (left turn) or not.
+	// The branches are expanded breadth-first, and the first grid points with unknown p value form the frontier.
+	struct STA_State
+	{
+		int row, column;
+		std::string direction;
+		bool first_excluded_point_found;
+	};
+	std::vector<std::vector<int>> frontier;
+	std::vector<STA_State> states = {{row, column, STA_direction, first_excluded_point_found}};
+	unsigned int max_depth		  = 2 * max_points;
+	for(unsigned int depth = 0; depth < max_depth && !states.empty() && frontier.size() < max_points; depth++)
+	{
+		std::vector<STA_State> next_states;
+		for(auto& state : states)
+		{
+			bool on_grid = STA_Point_On_Grid(state.row, state.column);
+			bool unknown = on_grid && p_value_grid[state.row][state.column] < 0.0;
+			if(unknown && frontier.size() < max_points && std::find(frontier.begin(), frontier.end(), std::vector<int>{state.row, state.column}) == frontier.end())
+				frontier.push_back({state.row, state.column});
+			bool excluded = on_grid && !unknown && p_value_grid[state.row][state.column] < 1.0 - certainty_level;
+			if(unknown || excluded)
+			{
+				STA_State left = state;
+				left.first_excluded_point_found = true;
+				STA_Go_Left(left.row, left.column, left.direction);
+				next_states.push_back(left);
+			}
+			if(unknown || !excluded)
+			{
+				STA_State right = state;
+				if(right.first_excluded_point_found)
+					STA_Go_Right(right.row, right.column, right.direction);
+				else
+					STA_Go_Forward(right.row, right.column, right.direction);
+				next_states.push_back(right);
+			}
+		}
+		states = next_states;
+	}
+	return frontier;
+}
+
+void Parameter_Scan::STA_Evaluate_Frontier(const std::vector<std::vector<int>>& frontier, obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, MPI_Comm group_communicator, unsigned int group, int mpi_rank)
+{
+	int group_rank;
+	MPI_Comm_rank(group_communicator, &group_rank);
+	if(mpi_rank == 0)
+	{
+		std::cout << std::endl
+				  << "Evaluate " << frontier.size() << " parameter points concurrently:" << std::endl;
+		for(unsigned int i = 0; i < frontier.size(); i++)
+		{
+			DM.Set_Mass(DM_masses[frontier[i][1]]);
+			DM.Set_Interaction_Parameter(couplings[frontier[i][0]], detector.Target_Particles());
+			std::cout << "\t" << ((i == 0) ? "Current:" : "Speculative:") << "\t"
+					  << "m_DM [MeV]:\t" << libphysica::Round(In_Units(DM.mass, MeV)) << "\t\t"
+					  << "sigma_p [cm2]:\t" << libphysica::Round(In_Units(DM.Get_Interaction_Parameter("Nuclei"), cm * cm)) << std::endl;
+		}
+	}
+	Print_Grid(mpi_rank, frontier[0][0], frontier[0][1]);
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	// Every group evaluates one point, and the groups' roots share the results.
+	std::vector<double> p_values(frontier.size(), -1.0);
+	if(group < frontier.size())
+	{
+		DM.Set_Mass(DM_masses[frontier[group][1]]);
+		DM.Set_Interaction_Parameter(couplings[frontier[group][0]], detector.Target_Particles());
+		// The group containing process 0 prints its data summary.
+		double p = Compute_p_Value(DM, detector, solar_model, halo_model, settings, group == 0, group_communicator);
+		if(group_rank == 0)
+			p_values[group] = p;
+	}
+	MPI_Allreduce(MPI_IN_PLACE, p_values.data(), p_values.size(), MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+	for(unsigned int i = 0; i < frontier.size(); i++)
+		p_value_grid[frontier[i][0]][frontier[i][1]] = p_values[i];
+	speculative_evaluations += frontier.size() - 1;
+	libphysica::Export_Table(results_path + "P_Values_Grid.txt", p_value_grid);
+	if(mpi_rank == 0)
+	{
+		std::cout << std::endl
+				  << std::endl;
+		libphysica::Print_Box("p = " + std::to_string(libphysica::Round(p_values[0])), 1);
+	}
+}
+
 void Parameter_Scan::Perform_STA_Scan(obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, int mpi_rank)
 {
 	Import_P_Values();
 	double mDM_original		 = DM.mass;
 	double coupling_original = DM.Get_Interaction_Parameter(detector.Target_Particles());
 
+	// Split the MPI processes into groups for the concurrent evaluation of the STA frontier.
+	int mpi_processes;
+	MPI_Comm_size(MPI_COMM_WORLD, &mpi_processes);
+	unsigned int groups = std::min(process_groups, static_cast<unsigned int>(mpi_processes));
+	unsigned int group	= mpi_rank % groups;
+	MPI_Comm group_communicator;
+	MPI_Comm_split(MPI_COMM_WORLD, group, mpi_rank, &group_communicator);
+	speculative_evaluations = 0;
+	wasted_evaluations		= 0;
+	std::set<std::vector<int>> speculative_points;
+
 	std::vector<int> first_excluded_point;
 
 	int counter				  = 0;
@@ -503,11 +885,20 @@ void Parameter_Scan::Perform_STA_Scan(obscura::DM_Particle& DM, obscura::DM_Dete
 	while(first_excluded_point_counter < 2)
 	{
 		MPI_Barrier(MPI_COMM_WORLD);
+		speculative_points.erase({row, column});
 		double p;
 		if(!STA_Point_On_Grid(row, column))
 			p = 1.0;
 		else if(p_value_grid[row][column] >= 0)
 			p = p_value_grid[row][column];
+		else if(groups > 1)
+		{
+			std::vector<std::vector<int>> frontier = STA_Frontier(row, column, STA_direction, !first_excluded_point.empty(), groups);
+			counter += frontier.size();
+			STA_Evaluate_Frontier(frontier, DM, detector, solar_model, halo_model, group_communicator, group, mpi_rank);
+			speculative_points.insert(frontier.begin() + 1, frontier.end());
+			p = p_value_grid[row][column];
+		}
 		else
 		{
 			DM.Set_Interaction_Parameter(couplings[row], detector.Target_Particles());
@@ -524,7 +915,7 @@ void Parameter_Scan::Perform_STA_Scan(obscura::DM_Particle& DM, obscura::DM_Dete
 			Print_Grid(mpi_rank, row, column);
 			MPI_Barrier(MPI_COMM_WORLD);
 
-			p = Compute_p_Value(sample_size, DM, detector, solar_model, halo_model, scattering_rate_interpolation_points, mpi_rank);
+			p = Compute_p_Value(DM, detector, solar_model, halo_model, settings);
 
 			p_value_grid[row][column] = p;
 			libphysica::Export_Table(results_path + "P_Values_Grid.txt", p_value_grid);
@@ -552,6 +943,12 @@ void Parameter_Scan::Perform_STA_Scan(obscura::DM_Particle& DM, obscura::DM_Dete
 		else
 			STA_Go_Right(row, column, STA_direction);
 	}
+	MPI_Comm_free(&group_communicator);
+	// Speculative points off the final STA path were wasted.
+	wasted_evaluations = speculative_points.size();
+	if(groups > 1 && mpi_rank == 0)
+		std::cout << std::endl
+				  << "Speculative evaluations:\t" << speculative_evaluations << " (wasted: " << wasted_evaluations << ")" << std::endl;
 	STA_Fill_Gaps();
 	Print_Grid(mpi_rank);
 	libphysica::Export_Table(results_path + "P_Values_Grid.txt", p_value_grid);
@@ -559,12 +956,45 @@ void Parameter_Scan::Perform_STA_Scan(obscura::DM_Particle& DM, obscura::DM_Dete
 	DM.Set_Interaction_Parameter(coupling_original, detector.Target_Particles());
 }
 
+unsigned int Parameter_Scan::Speculative_Evaluations() const
+{
+	return speculative_evaluations;
+}
+
+unsigned int Parameter_Scan::Wasted_Evaluations() const
+{
+	return wasted_evaluations;
+}
+
 void Parameter_Scan::Perform_Full_Scan(obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, int mpi_rank)
 {
 	Import_P_Values();
 	double mDM_original		 = DM.mass;
 	double coupling_original = DM.Get_Interaction_Parameter(detector.Target_Particles());
 
+	// With several process groups, process 0 distributes the grid points and the remaining processes evaluate them.
+	int mpi_processes;
+	MPI_Comm_size(MPI_COMM_WORLD, &mpi_processes);
+	unsigned int groups = std::min(process_groups, static_cast<unsigned int>(mpi_processes - 1));
+	if(groups > 1)
+	{
+		MPI_Comm group_communicator;
+		MPI_Comm_split(MPI_COMM_WORLD, (mpi_rank == 0) ? MPI_UNDEFINED : (mpi_rank - 1) % groups, mpi_rank, &group_communicator);
+		if(mpi_rank == 0)
+			Full_Scan_Master(groups);
+		else
+		{
+			Full_Scan_Worker(DM, detector, solar_model, halo_model, group_communicator);
+			MPI_Comm_free(&group_communicator);
+		}
+		for(auto& row : p_value_grid)
+			MPI_Bcast(row.data(), row.size(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+		Print_Grid(mpi_rank);
+		DM.Set_Mass(mDM_original);
+		DM.Set_Interaction_Parameter(coupling_original, detector.Target_Particles());
+		return;
+	}
+
 	double p_critical					  = 1.0 - certainty_level;
 	unsigned int counter				  = 0;
 	unsigned int last_excluded_mass_index = DM_masses.size();
@@ -595,7 +1025,7 @@ void Parameter_Scan::Perform_Full_Scan(obscura::DM_Particle& DM, obscura::DM_Det
 				Print_Grid(mpi_rank, row, column);
 				MPI_Barrier(MPI_COMM_WORLD);
 
-				p = Compute_p_Value(sample_size, DM, detector, solar_model, halo_model, scattering_rate_interpolation_points, mpi_rank);
+				p = Compute_p_Value(DM, detector, solar_model, halo_model, settings);
 
 				p_value_grid[row][column] = p;
 				libphysica::Export_Table(results_path + "P_Values_Grid.txt", p_value_grid);
@@ -627,6 +1057,69 @@ void Parameter_Scan::Perform_Full_Scan(obscura::DM_Particle& DM, obscura::DM_Det
 	DM.Set_Interaction_Parameter(coupling_original, detector.Target_Particles());
 }
 
+void Parameter_Scan::Full_Scan_Master(unsigned int groups)
+{
+	Full_Scan_Queue queue(p_value_grid, 1.0 - certainty_level);
+
+	// Tag 1 assigns a grid point to a group, tag 0 stops it.
+	unsigned int counter = 0, active_groups = 0;
+	for(unsigned int group = 0; group < groups; group++)
+	{
+		std::vector<int> point = queue.Next_Point();
+		if(point[0] >= 0)
+			active_groups++;
+		MPI_Send(point.data(), 2, MPI_INT, group + 1, (point[0] < 0) ? 0 : 1, MPI_COMM_WORLD);
+	}
+	while(active_groups > 0)
+	{
+		std::vector<double> result(3);
+		MPI_Status mpi_status;
+		MPI_Recv(result.data(), 3, MPI_DOUBLE, MPI_ANY_SOURCE, 2, MPI_COMM_WORLD, &mpi_status);
+		int row = result[0], column = result[1];
+		queue.Add_Result(row, column, result[2]);
+		libphysica::Export_Table(results_path + "P_Values_Grid.txt", p_value_grid);
+		std::cout << std::endl
+				  << ++counter << ")\t"
+				  << "m_DM [MeV]:\t" << libphysica::Round(In_Units(DM_masses[column], MeV)) << "\t\t"
+				  << "coupling:\t" << libphysica::Round(couplings[row]) << "\t\t"
+				  << "p = " << libphysica::Round(result[2]) << "\t(group " << (mpi_status.MPI_SOURCE - 1) << ")" << std::endl;
+		Print_Grid(0, row, column);
+
+		std::vector<int> point = queue.Next_Point();
+		if(point[0] < 0)
+			active_groups--;
+		MPI_Send(point.data(), 2, MPI_INT, mpi_status.MPI_SOURCE, (point[0] < 0) ? 0 : 1, MPI_COMM_WORLD);
+	}
+
+	// Rows below the first row without exclusions are not excluded either.
+	queue.Fill_Remaining_Rows();
+	libphysica::Export_Table(results_path + "P_Values_Grid.txt", p_value_grid);
+}
+
+void Parameter_Scan::Full_Scan_Worker(obscura::DM_Particle& DM, obscura::DM_Detector& detector, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, MPI_Comm group_communicator)
+{
+	int group_rank;
+	MPI_Comm_rank(group_communicator, &group_rank);
+	while(true)
+	{
+		std::vector<int> point(2);
+		if(group_rank == 0)
+			MPI_Recv(point.data(), 2, MPI_INT, 0, MPI_ANY_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		MPI_Bcast(point.data(), 2, MPI_INT, 0, group_communicator);
+		if(point[0] < 0)
+			break;
+		DM.Set_Mass(DM_masses[point[1]]);
+		DM.Set_Interaction_Parameter(couplings[point[0]], detector.Target_Particles());
+		// Process 0 reports the results, so the groups print no data summaries, and their progress bars are off, since process 0 is in no group.
+		double p = Compute_p_Value(DM, detector, solar_model, halo_model, settings, false, group_communicator);
+		if(group_rank == 0)
+		{
+			std::vector<double> result = {1.0 * point[0], 1.0 * point[1], p};
+			MPI_Send(result.data(), 3, MPI_DOUBLE, 0, 2, MPI_COMM_WORLD);
+		}
+	}
+}
+
 void Parameter_Scan::Print_Grid(int mpi_rank, int marker_row, int marker_column)
 {
 	if(mpi_rank == 0)
@@ -1,5 +1,9 @@
 #include "Reflection_Spectrum.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
 #include "libphysica/Natural_Units.hpp"
 #include "libphysica/Special_Functions.hpp"
 #include "libphysica/Statistics.hpp"
@@ -9,10 +13,20 @@ namespace DaMaSCUS_SUN
 
 using namespace libphysica::natural_units;
 
-Reflection_Spectrum::Reflection_Spectrum(const Simulation_Data& simulation_data, Solar_Model& solar_model, obscura::DM_Distribution& halo_model, double mDM, int iso_ring)
+Reflection_Spectrum::Reflection_Spectrum(const Simulation_Data& simulation_data, const Solar_Model& solar_model, obscura::DM_Distribution& halo_model, double mDM, int iso_ring, bool binned_KDE)
 : DM_Distribution("Reflection spectrum", 0.0, simulation_data.Minimum_Speed(), 1.05 * simulation_data.Highest_Speed(iso_ring)), distance(AU)
 {
-	kde_speed								   = libphysica::Perform_KDE(simulation_data.data[iso_ring], v_domain[0], v_domain[1]);
+	// Streamed data is smoothed directly from the histogram, with the bandwidth from the streamed moments, but not below the bin width.
+	// The PDF is normalized to the binned fraction of the data, since the overflow above the histogram's range is missing.
+	if(simulation_data.Streaming())
+	{
+		kde_speed = Perform_Histogram_KDE(simulation_data.Histogram_Weights(iso_ring), v_domain[0], v_domain[1], simulation_data.Histogram_Bin_Width(), std::max(simulation_data.KDE_Bandwidth(iso_ring), simulation_data.Histogram_Bin_Width()));
+		kde_speed.Multiply(1.0 - simulation_data.Histogram_Overflow(iso_ring));
+	}
+	else if(binned_KDE)
+		kde_speed = Perform_Binned_KDE(simulation_data.data[iso_ring], v_domain[0], v_domain[1]);
+	else
+		kde_speed = libphysica::Perform_KDE(simulation_data.data[iso_ring], v_domain[0], v_domain[1]);
 	total_entering_rate						   = DM_Entering_Rate(solar_model, halo_model, mDM);
 	total_reflection_rate					   = simulation_data.Reflection_Ratio(iso_ring) * total_entering_rate;
 	unsigned int number_of_isoreflection_rings = simulation_data.data.size();
@@ -63,7 +77,7 @@ void Reflection_Spectrum::Set_Distance(double d)
 	distance = d;
 }
 
-double DM_Entering_Rate(Solar_Model& solar_model, obscura::DM_Distribution& halo_model, double mDM)
+double DM_Entering_Rate(const Solar_Model& solar_model, obscura::DM_Distribution& halo_model, double mDM)
 {
 	double number_density = halo_model.DM_density / mDM;
 	double u_average	  = halo_model.Average_Speed();
@@ -72,4 +86,129 @@ double DM_Entering_Rate(Solar_Model& solar_model, obscura::DM_Distribution& halo
 	return rSun * rSun * M_PI * number_density * (u_average + v_esc * v_esc * u_inv_average);
 }
 
-}	// namespace DaMaSCUS_SUN
\ No newline at end of file
+// In-place radix-2 FFT, the size must be a power of 2.
+static void Fast_Fourier_Transform(std::vector<std::complex<double>>& signal, bool inverse)
+{
+	unsigned int size = signal.size();
+	for(unsigned int i = 1, j = 0; i < size; i++)
+	{
+		unsigned int bit = size >> 1;
+		for(; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if(i < j)
+			std::swap(signal[i], signal[j]);
+	}
+	for(unsigned int length = 2; length <= size; length <<= 1)
+	{
+		double angle = (inverse ? 2.0 : -2.0) * M_PI / length;
+		std::complex<double> root(std::cos(angle), std::sin(angle));
+		for(unsigned int i = 0; i < size; i += length)
+		{
+			std::complex<double> factor(1.0, 0.0);
+			for(unsigned int j = 0; j < length / 2; j++)
+			{
+				std::complex<double> u	   = signal[i + j];
+				std::complex<double> v	   = signal[i + j + length / 2] * factor;
+				signal[i + j]			   = u + v;
+				signal[i + j + length / 2] = u - v;
+				factor *= root;
+			}
+		}
+	}
+	if(inverse)
+		for(auto& entry : signal)
+			entry /= size;
+}
+
+// Gaussian smoothing of the counts on the grid points x_min + (j + offset) * dx, tabulated and normalized on the first output_points of them.
+// The convolution uses the FFT, zero-padded against wrap-around. The counts get mirrored at x_min for the boundary correction.
+static libphysica::Interpolation Smooth_Binned_Data(const std::vector<double>& counts, double x_min, double dx, double offset, unsigned int output_points, double bandwidth)
+{
+	unsigned int kernel_width = std::min<unsigned int>(std::ceil(5.0 * bandwidth / dx), 2 * output_points);
+	unsigned int fft_size	  = 1;
+	while(fft_size < 2 * std::max<unsigned int>(counts.size(), output_points) + 2 * kernel_width)
+		fft_size <<= 1;
+	std::vector<std::complex<double>> signal(fft_size, 0.0), kernel(fft_size, 0.0);
+	for(unsigned int j = 0; j < counts.size(); j++)
+	{
+		// With grid points on the boundary, the first point is its own mirror image.
+		signal[j] += counts[j];
+		signal[(offset == 0.0) ? (fft_size - j) % fft_size : fft_size - 1 - j] += counts[j];
+	}
+	for(unsigned int d = 0; d <= kernel_width; d++)
+		kernel[d] = kernel[(fft_size - d) % fft_size] = std::exp(-0.5 * (d * dx / bandwidth) * (d * dx / bandwidth));
+	Fast_Fourier_Transform(signal, false);
+	Fast_Fourier_Transform(kernel, false);
+	for(unsigned int i = 0; i < fft_size; i++)
+		signal[i] *= kernel[i];
+	Fast_Fourier_Transform(signal, true);
+
+	// The mirrored density is flat at x_min, so bin centers start the table with the first bin's value.
+	std::vector<std::vector<double>> table;
+	if(offset > 0.0)
+		table.push_back({x_min, std::max(signal[0].real(), 0.0)});
+	for(unsigned int i = 0; i < output_points; i++)
+		table.push_back({x_min + (i + offset) * dx, std::max(signal[i].real(), 0.0)});
+	double norm = 0.0;
+	for(unsigned int i = 1; i < table.size(); i++)
+		norm += 0.5 * (table[i][0] - table[i - 1][0]) * (table[i][1] + table[i - 1][1]);
+	libphysica::Interpolation kde(table);
+	kde.Multiply(1.0 / norm);
+	return kde;
+}
+
+libphysica::Interpolation Perform_Binned_KDE(const std::vector<libphysica::DataPoint>& data, double x_min, double x_max, double bandwidth, unsigned int grid_points)
+{
+	if(data.empty() || grid_points < 2 || x_max <= x_min)
+	{
+		std::cerr << "Error in Perform_Binned_KDE(): The KDE needs data, an interval, and at least 2 grid points." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	// 1. Bandwidth selection via Silverman's rule of thumb, with the effective sample size of the weighted data.
+	if(bandwidth <= 0.0)
+	{
+		double weight_sum = 0.0, weight_squared_sum = 0.0, mean = 0.0, variance = 0.0;
+		for(auto& point : data)
+		{
+			weight_sum += point.weight;
+			weight_squared_sum += point.weight * point.weight;
+			mean += point.weight * point.value;
+		}
+		mean /= weight_sum;
+		for(auto& point : data)
+			variance += point.weight * (point.value - mean) * (point.value - mean);
+		variance /= weight_sum;
+		double effective_sample_size = weight_sum * weight_sum / weight_squared_sum;
+		bandwidth					 = std::pow(4.0 / 3.0 / effective_sample_size, 0.2) * std::sqrt(variance);
+	}
+
+	// 2. Linear binning, where each data point is shared by its two neighbouring grid points.
+	double dx = (x_max - x_min) / (grid_points - 1);
+	std::vector<double> counts(grid_points, 0.0);
+	for(auto& point : data)
+	{
+		double t		= std::min(std::max((point.value - x_min) / dx, 0.0), grid_points - 1.0);
+		unsigned int j	= std::min<unsigned int>(t, grid_points - 2);
+		double fraction = t - j;
+		counts[j] += (1.0 - fraction) * point.weight;
+		counts[j + 1] += fraction * point.weight;
+	}
+
+	// 3. Convolution with the kernel and normalization
+	return Smooth_Binned_Data(counts, x_min, dx, 0.0, grid_points, bandwidth);
+}
+
+libphysica::Interpolation Perform_Histogram_KDE(const std::vector<double>& bin_weights, double x_min, double x_max, double bin_width, double bandwidth)
+{
+	if(bin_weights.empty() || bin_width <= 0.0 || bandwidth <= 0.0 || x_max <= x_min)
+	{
+		std::cerr << "Error in Perform_Histogram_KDE(): The KDE needs bins, an interval, and a bandwidth." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	// Tabulation at the bin centers up to the first one beyond x_max
+	unsigned int output_points = std::ceil((x_max - x_min) / bin_width - 0.5) + 1;
+	return Smooth_Binned_Data(bin_weights, x_min, bin_width, 0.5, output_points, bandwidth);
+}
+
+}	// namespace DaMaSCUS_SUN
@@ -0,0 +1,291 @@
+#include "Simulation_Batch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "libphysica/Statistics.hpp"
+
+namespace DaMaSCUS_SUN
+{
+
+using namespace libphysica::natural_units;
+
+Trajectory_Batch_Simulator::Trajectory_Batch_Simulator(const Solar_Model& model, unsigned int number_of_lanes, unsigned long int max_time_steps, unsigned int max_scatterings, double max_distance)
+: solar_model(model), scalar_simulator(model, max_time_steps, max_scatterings, max_distance), lanes(std::max(1u, number_of_lanes)), maximum_time_steps(max_time_steps), maximum_scatterings(max_scatterings), maximum_distance(max_distance)
+{
+	for(auto lane_data : {&time, &radius, &phi, &v_radial, &angular_momentum, &mass, &time_step, &minus_log_xi, &radius_new, &v_radial_new, &phi_new, &time_step_new, &error_ratio})
+		lane_data->resize(lanes, 0.0);
+	axis_x			 = std::vector<libphysica::Vector>(lanes, libphysica::Vector({1.0, 0.0, 0.0}));
+	axis_y			 = std::vector<libphysica::Vector>(lanes, libphysica::Vector({0.0, 1.0, 0.0}));
+	rejections		 = std::vector<unsigned int>(lanes, 0);
+	time_steps		 = std::vector<unsigned long int>(lanes, 0);
+	scatterings		 = std::vector<unsigned long int>(lanes, 0);
+	trajectory_index = std::vector<int>(lanes, -1);
+
+	std::random_device rd;
+	random_seed = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+
+	// Same error tolerances as the Free_Particle_Propagator
+	error_tolerances[0] = 1.0 * km;
+	error_tolerances[1] = 1.0e-3 * km / sec;
+	error_tolerances[2] = 1.0e-7;
+}
+
+void Trajectory_Batch_Simulator::Load_Lane(unsigned int lane, const Event& event)
+{
+	libphysica::Vector axis_z = event.position.Cross(event.velocity).Normalized();
+	axis_x[lane]			  = event.position.Normalized();
+	axis_y[lane]			  = axis_z.Cross(axis_x[lane]);
+
+	time[lane]			   = event.time;
+	radius[lane]		   = event.Radius();
+	phi[lane]			   = 0.0;
+	v_radial[lane]		   = (radius[lane] == 0) ? event.Speed() : event.position.Dot(event.velocity) / radius[lane];
+	angular_momentum[lane] = (event.position.Cross(event.velocity)).Dot(axis_z);
+	time_step[lane]		   = 0.1 * sec;
+	rejections[lane]	   = 0;
+}
+
+void Trajectory_Batch_Simulator::Empty_Lane(unsigned int lane)
+{
+	// Empty lanes keep finite dummy values, because the sweep runs over all lanes.
+	trajectory_index[lane] = -1;
+	radius[lane]		   = rSun;
+	v_radial[lane]		   = 0.0;
+	angular_momentum[lane] = 0.0;
+	mass[lane]			   = mSun;
+	time_step[lane]		   = 0.1 * sec;
+}
+
+void Trajectory_Batch_Simulator::Start_Free_Propagation(unsigned int lane, const Event& event, std::mt19937& PRNG)
+{
+	Load_Lane(lane, event);
+	time_steps[lane]   = 0;
+	minus_log_xi[lane] = -log(libphysica::Sample_Uniform(PRNG));
+}
+
+Event Trajectory_Batch_Simulator::Lane_Event(unsigned int lane) const
+{
+	double r				= radius[lane];
+	double v_phi			= angular_momentum[lane] / r / r;
+	libphysica::Vector xNew = r * (cos(phi[lane]) * axis_x[lane] + sin(phi[lane]) * axis_y[lane]);
+	libphysica::Vector vNew = (v_radial[lane] * cos(phi[lane]) - v_phi * r * sin(phi[lane])) * axis_x[lane] + (v_radial[lane] * sin(phi[lane]) + r * v_phi * cos(phi[lane])) * axis_y[lane];
+	return Event(time[lane], xNew, vNew);
+}
+
+double Trajectory_Batch_Simulator::Lane_Speed(unsigned int lane) const
+{
+	if(radius[lane] == 0 || angular_momentum[lane] == 0)
+		return v_radial[lane];
+	else
+		return sqrt(v_radial[lane] * v_radial[lane] + angular_momentum[lane] * angular_momentum[lane] / radius[lane] / radius[lane]);
+}
+
+void Trajectory_Batch_Simulator::Runge_Kutta_45_Sweep()
+{
+	// One Runge-Kutta-Fehlberg attempt for every lane with the shared Butcher tableau. The stage loops have fixed lengths, so the compiler unrolls them and the lane loop stays vectorizable.
+	for(unsigned int l = 0; l < lanes; l++)
+	{
+		double dt  = time_step[l];
+		double r   = radius[l];
+		double v   = v_radial[l];
+		double J   = angular_momentum[l];
+		double GM  = G_Newton * mass[l];
+		auto dv_dt = [J, GM](double x) {
+			return J * J / x / x / x - GM / x / x;
+		};
+		auto dphi_dt = [J](double x) {
+			return J / x / x;
+		};
+
+		double k_r[6], k_v[6], k_p[6];
+		for(unsigned int i = 0; i < 6; i++)
+		{
+			double r_i = r;
+			double v_i = v;
+			for(unsigned int j = 0; j < i; j++)
+			{
+				r_i += RKF_a[i][j] * k_r[j];
+				v_i += RKF_a[i][j] * k_v[j];
+			}
+			k_r[i] = dt * v_i;
+			k_v[i] = dt * dv_dt(r_i);
+			k_p[i] = dt * dphi_dt(r_i);
+		}
+
+		double radius_4	  = r;
+		double v_radial_4 = v;
+		double phi_4	  = phi[l];
+		double radius_5	  = r;
+		double v_radial_5 = v;
+		double phi_5	  = phi[l];
+		for(unsigned int i = 0; i < 6; i++)
+		{
+			radius_4 += RKF_b_4[i] * k_r[i];
+			v_radial_4 += RKF_b_4[i] * k_v[i];
+			phi_4 += RKF_b_4[i] * k_p[i];
+			radius_5 += RKF_b_5[i] * k_r[i];
+			v_radial_5 += RKF_b_5[i] * k_v[i];
+			phi_5 += RKF_b_5[i] * k_p[i];
+		}
+
+		double ratio_r	 = error_tolerances[0] / fabs(radius_5 - radius_4);
+		double ratio_v	 = error_tolerances[1] / fabs(v_radial_5 - v_radial_4);
+		double ratio_phi = error_tolerances[2] / fabs(phi_5 - phi_4);
+		error_ratio[l]	 = std::min(ratio_r, std::min(ratio_v, ratio_phi));
+		time_step_new[l] = 0.84 * sqrt(sqrt(error_ratio[l])) * dt;
+		radius_new[l]	 = radius_4;
+		v_radial_new[l]	 = v_radial_4;
+		phi_new[l]		 = phi_4;
+	}
+}
+
+unsigned int Trajectory_Batch_Simulator::Lanes() const
+{
+	return lanes;
+}
+
+void Trajectory_Batch_Simulator::Fix_PRNG_Seed(int fixed_seed)
+{
+	random_seed			   = fixed_seed;
+	simulated_trajectories = 0;
+}
+
+std::vector<Trajectory_Result> Trajectory_Batch_Simulator::Simulate(const std::vector<Event>& initial_conditions, obscura::DM_Particle& DM)
+{
+	std::vector<std::mt19937> PRNGs(initial_conditions.size());
+	for(auto& PRNG : PRNGs)
+		Seed_PRNG_Stream(PRNG, random_seed, 0, simulated_trajectories++);
+	return Simulate(initial_conditions, PRNGs, DM);
+}
+
+std::vector<Trajectory_Result> Trajectory_Batch_Simulator::Simulate(const std::vector<Event>& initial_conditions, std::vector<std::mt19937>& PRNGs, obscura::DM_Particle& DM)
+{
+	if(PRNGs.size() != initial_conditions.size())
+	{
+		std::cerr << "Error in Trajectory_Batch_Simulator::Simulate(): " << PRNGs.size() << " random number generators for " << initial_conditions.size() << " initial conditions." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+
+	std::vector<Trajectory_Result> results;
+	for(auto& initial_condition : initial_conditions)
+		results.push_back(Trajectory_Result(initial_condition, initial_condition, 0));
+
+	// 1. Fill the lanes
+	unsigned int next_trajectory = 0;
+	unsigned int active_lanes	 = 0;
+	auto refill_lane			 = [this, &initial_conditions, &PRNGs, &next_trajectory, &active_lanes](unsigned int lane) {
+		if(next_trajectory < initial_conditions.size())
+		{
+			trajectory_index[lane] = next_trajectory;
+			scatterings[lane]	   = 0;
+			Start_Free_Propagation(lane, initial_conditions[next_trajectory], PRNGs[next_trajectory]);
+			next_trajectory++;
+			active_lanes++;
+		}
+		else
+			Empty_Lane(lane);
+	};
+	auto finish_lane = [this, &results, &initial_conditions, &active_lanes, &refill_lane](unsigned int lane, const Event& final_event) {
+		results[trajectory_index[lane]] = Trajectory_Result(initial_conditions[trajectory_index[lane]], final_event, scatterings[lane]);
+		active_lanes--;
+		refill_lane(lane);
+	};
+	for(unsigned int lane = 0; lane < lanes; lane++)
+		refill_lane(lane);
+
+	while(active_lanes > 0)
+	{
+		// 2. Lanes starting a new step: analytic Kepler orbits outside the Sun and the enclosed mass
+		for(unsigned int lane = 0; lane < lanes; lane++)
+		{
+			// A finished lane gets refilled right away, and the new particle is checked again.
+			while(analytic_kepler_orbits && trajectory_index[lane] >= 0 && rejections[lane] == 0 && radius[lane] > rSun)
+			{
+				Event event_exit  = Lane_Event(lane);
+				Event event_entry = event_exit;
+				if(Kepler_Shift(event_entry, rSun))
+				{
+					unsigned long int steps = time_steps[lane];
+					Load_Lane(lane, event_entry);
+					time_steps[lane] = steps;
+					break;
+				}
+				else if(radius[lane] < maximum_distance && event_exit.Asymptotic_Speed_Sqr(solar_model) > 0.0 && Kepler_Shift(event_exit, maximum_distance))
+					finish_lane(lane, event_exit);
+				else
+					break;
+			}
+			if(trajectory_index[lane] >= 0 && rejections[lane] == 0)
+				mass[lane] = solar_model.Mass(solar_model.Radial_Grid_Lookup(radius[lane]));
+		}
+
+		// 3. One Runge-Kutta attempt for all lanes
+		Runge_Kutta_45_Sweep();
+
+		// 4. Accepted steps, scatterings, and finished trajectories
+		for(unsigned int lane = 0; lane < lanes; lane++)
+		{
+			if(trajectory_index[lane] < 0)
+				continue;
+			double dt		= time_step[lane];
+			time_step[lane] = time_step_new[lane];
+			if(error_ratio[lane] <= 1.0 && rejections[lane] < maximum_step_rejections)
+			{
+				rejections[lane]++;
+				continue;
+			}
+			if(error_ratio[lane] <= 1.0)
+				std::cerr << "Warning in Trajectory_Batch_Simulator::Simulate(): Step accepted after " << rejections[lane] << " rejections without reaching the error tolerance." << std::endl;
+			rejections[lane] = 0;
+			time_steps[lane]++;
+			double r_before	 = radius[lane];
+			time[lane] += dt;
+			radius[lane]   = radius_new[lane];
+			v_radial[lane] = v_radial_new[lane];
+			phi[lane]	   = phi_new[lane];
+			double r_after = radius[lane];
+			double v_after = Lane_Speed(lane);
+
+			if(v_after > v_max)
+			{
+				std::cerr << "\nWarning in Trajectory_Batch_Simulator::Simulate(): DM speed exceeds the maximum of v_max = " << v_max << std::endl
+						  << "\tAbort simulation." << std::endl;
+				finish_lane(lane, Lane_Event(lane));
+				continue;
+			}
+
+			bool scattering = false;
+			bool reflection = false;
+			if(r_after < rSun)
+			{
+				double total_rate	 = solar_model.Total_DM_Scattering_Rate(DM, r_after, v_after);
+				double time_step_max = 0.1 / total_rate;
+				if(time_step[lane] > time_step_max)
+					time_step[lane] = time_step_max;
+				minus_log_xi[lane] -= time_step[lane] * total_rate;
+				scattering = (minus_log_xi[lane] < 0.0);
+			}
+			else if(r_before < maximum_distance && r_after > maximum_distance && v_after > solar_model.Local_Escape_Speed(r_after))
+				reflection = true;
+
+			if(scattering && scatterings[lane] < maximum_scatterings)
+			{
+				// The scalar simulator scatters with the trajectory's own generator.
+				std::mt19937& PRNG = PRNGs[trajectory_index[lane]];
+				Event event		   = Lane_Event(lane);
+				std::swap(scalar_simulator.PRNG, PRNG);
+				scalar_simulator.Scatter(event, DM);
+				std::swap(scalar_simulator.PRNG, PRNG);
+				scatterings[lane]++;
+				Start_Free_Propagation(lane, event, PRNG);
+			}
+			else if(scattering || reflection || time_steps[lane] >= maximum_time_steps)
+				finish_lane(lane, Lane_Event(lane));
+		}
+	}
+	return results;
+}
+
+}	// namespace DaMaSCUS_SUN
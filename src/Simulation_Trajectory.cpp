@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <mpi.h>
+#include <numeric>
 
 #include "libphysica/Special_Functions.hpp"
 #include "libphysica/Statistics.hpp"
@@ -14,8 +16,8 @@ namespace DaMaSCUS_SUN
 using namespace libphysica::natural_units;
 
 // 1. Result of one trajectory
-Trajectory_Result::Trajectory_Result(const Event& event_ini, const Event& event_final, unsigned long int nScat)
-: initial_event(event_ini), final_event(event_final), number_of_scatterings(nScat)
+Trajectory_Result::Trajectory_Result(const Event& event_ini, const Event& event_final, unsigned long int nScat, double w)
+: initial_event(event_ini), final_event(event_final), number_of_scatterings(nScat), weight(w)
 {
 }
 
@@ -31,14 +33,14 @@ bool Trajectory_Result::Particle_Free() const
 	return number_of_scatterings == 0;
 }
 
-bool Trajectory_Result::Particle_Captured(Solar_Model& solar_model) const
+bool Trajectory_Result::Particle_Captured(const Solar_Model& solar_model) const
 {
 	double r	= final_event.Radius();
 	double vesc = solar_model.Local_Escape_Speed(r);
 	return final_event.Speed() < vesc;
 }
 
-void Trajectory_Result::Print_Summary(Solar_Model& solar_model, unsigned int mpi_rank)
+void Trajectory_Result::Print_Summary(const Solar_Model& solar_model, unsigned int mpi_rank)
 {
 	if(mpi_rank == 0)
 	{
@@ -67,14 +69,14 @@ void Trajectory_Result::Print_Summary(Solar_Model& solar_model, unsigned int mpi
 
 // 2. Simulator
 Trajectory_Simulator::Trajectory_Simulator(const Solar_Model& model, unsigned long int max_time_steps, unsigned int max_scatterings, double max_distance)
-: solar_model(model), maximum_time_steps(max_time_steps), maximum_scatterings(max_scatterings), maximum_distance(max_distance)
+: solar_model(model), diffusion_steps(0), maximum_temperature(model.Temperature(0.0)), short_circuited_trajectories(0), maximum_time_steps(max_time_steps), maximum_scatterings(max_scatterings), maximum_distance(max_distance)
 {
 	// Pseudo-random number generator
 	std::random_device rd;
 	PRNG.seed(rd());
 }
 
-bool Trajectory_Simulator::Propagate_Freely(Event& current_event, obscura::DM_Particle& DM, std::ofstream& f)
+bool Trajectory_Simulator::Propagate_Freely(Event& current_event, obscura::DM_Particle& DM)
 {
 	// 1. Define a equation-of-motion-solver in the orbital plane
 	Free_Particle_Propagator particle_propagator(current_event);
@@ -87,7 +89,33 @@ bool Trajectory_Simulator::Propagate_Freely(Event& current_event, obscura::DM_Pa
 	{
 		time_steps++;
 		double r_before = particle_propagator.Current_Radius();
-		particle_propagator.Runge_Kutta_45_Step(solar_model.Mass(r_before));
+		double v_before = particle_propagator.Current_Speed();
+
+		// Outside the Sun, the orbit is a Kepler orbit, which we can solve analytically instead of integrating it.
+		if(analytic_kepler_orbits && r_before > rSun)
+		{
+			Event event_exit  = particle_propagator.Event_In_3D();
+			Event event_entry = event_exit;
+			if(Kepler_Shift(event_entry, rSun))
+			{
+				// The particle re-enters the Sun, and the numerical integration continues inside.
+				if(saving_current_trajectory)
+					Save_Event(event_entry, DM);
+				particle_propagator	= Free_Particle_Propagator(event_entry);
+				r_before			= particle_propagator.Current_Radius();
+				v_before			= particle_propagator.Current_Speed();
+			}
+			else if(r_before < maximum_distance && event_exit.Asymptotic_Speed_Sqr(solar_model) > 0.0 && Kepler_Shift(event_exit, maximum_distance))
+			{
+				// The particle escapes and reaches the maximum distance.
+				if(saving_current_trajectory)
+					Save_Event(event_exit, DM);
+				current_event = event_exit;
+				return true;
+			}
+		}
+
+		particle_propagator.Runge_Kutta_45_Step(solar_model.Mass(solar_model.Radial_Grid_Lookup(r_before)));
 		double r_after = particle_propagator.Current_Radius();
 		double v_after = particle_propagator.Current_Speed();
 
@@ -98,22 +126,30 @@ bool Trajectory_Simulator::Propagate_Freely(Event& current_event, obscura::DM_Pa
 			return false;
 		}
 
-		if(save_trajectories && time_steps % 20 == 0)
-		{
-			Event event	 = particle_propagator.Event_In_3D();
-			double r	 = event.Radius();
-			double v	 = event.Speed();
-			double vesc2 = solar_model.Local_Escape_Speed(r) * solar_model.Local_Escape_Speed(r);
-			double E	 = 1.0 / DM.mass * (v * v - vesc2);
-			f << In_Units(event.time, sec) << "\t"
-			  << In_Units(event.position[0], km) << "\t" << In_Units(event.position[1], km) << "\t" << In_Units(event.position[2], km) << "\t"
-			  << In_Units(event.velocity[0], km / sec) << "\t" << In_Units(event.velocity[1], km / sec) << "\t" << In_Units(event.velocity[2], km / sec) << "\t" << In_Units(E, eV) << std::endl;
-		}
+		if(saving_current_trajectory && time_steps % saving_stride == 0)
+			Save_Event(particle_propagator.Event_In_3D(), DM);
 
 		// Check for scatterings and reflection
 		bool scattering = false;
 		bool reflection = false;
-		if(r_after < rSun)
+		if(optical_depth_sampling && (r_before < rSun || r_after < rSun))
+		{
+			// The optical depth along the step is integrated with Simpson's rule, and the scattering point is found within the step.
+			double rate_before	 = solar_model.Total_DM_Scattering_Rate(DM, r_before, v_before);
+			double total_rate;
+			double optical_depth = Optical_Depth(particle_propagator, DM, 1.0, rate_before, total_rate);
+			if(optical_depth > minus_log_xi)
+			{
+				particle_propagator.Rewind_Last_Step(Scattering_Step_Fraction(particle_propagator, DM, minus_log_xi, rate_before, optical_depth));
+				scattering = true;
+			}
+			else
+				minus_log_xi -= optical_depth;
+			// The optical depth of the next step should not exceed one, such that the quadrature resolves the change of the rate.
+			if(total_rate > 0.0 && particle_propagator.time_step > 1.0 / total_rate)
+				particle_propagator.time_step = 1.0 / total_rate;
+		}
+		else if(r_after < rSun)
 		{
 			double total_rate	 = solar_model.Total_DM_Scattering_Rate(DM, r_after, v_after);
 			double time_step_max = 0.1 / total_rate;
@@ -133,6 +169,58 @@ bool Trajectory_Simulator::Propagate_Freely(Event& current_event, obscura::DM_Pa
 	return success;
 }
 
+double Trajectory_Simulator::Optical_Depth(const Free_Particle_Propagator& particle_propagator, obscura::DM_Particle& DM, double fraction, double rate_before, double& rate_end) const
+{
+	// Simpson's rule along the interpolated orbit from the start of the last step to the given fraction of it
+	double r_mid, v_mid, r_end, v_end;
+	particle_propagator.Interpolate_Last_Step(fraction / 2.0, r_mid, v_mid);
+	particle_propagator.Interpolate_Last_Step(fraction, r_end, v_end);
+	double rate_mid = solar_model.Total_DM_Scattering_Rate(DM, r_mid, v_mid);
+	rate_end		= solar_model.Total_DM_Scattering_Rate(DM, r_end, v_end);
+	return fraction * particle_propagator.Last_Time_Step() / 6.0 * (rate_before + 4.0 * rate_mid + rate_end);
+}
+
+double Trajectory_Simulator::Scattering_Step_Fraction(const Free_Particle_Propagator& particle_propagator, obscura::DM_Particle& DM, double optical_depth, double rate_before, double step_optical_depth) const
+{
+	// Newton's method, where the derivative of the optical depth with respect to the fraction is the local rate times the time step.
+	// The first guess assumes a constant rate along the step, and the optical depth grows monotonically, such that a bisection step replaces a Newton step leaving the bracket.
+	double fraction_min = 0.0;
+	double fraction_max = 1.0;
+	double fraction		= optical_depth / step_optical_depth;
+	for(unsigned int i = 0; i < 50; i++)
+	{
+		double rate;
+		double residual = Optical_Depth(particle_propagator, DM, fraction, rate_before, rate) - optical_depth;
+		if(residual < 0.0)
+			fraction_min = fraction;
+		else
+			fraction_max = fraction;
+		double fraction_new = (rate > 0.0) ? fraction - residual / (rate * particle_propagator.Last_Time_Step()) : fraction_min;
+		if(fraction_new <= fraction_min || fraction_new >= fraction_max)
+			fraction_new = (fraction_min + fraction_max) / 2.0;
+		if(fabs(fraction_new - fraction) < 1.0e-6)
+			return fraction_new;
+		fraction = fraction_new;
+	}
+	return fraction;
+}
+
+void Trajectory_Simulator::Save_Event(const Event& event, obscura::DM_Particle& DM)
+{
+	double v	= event.Speed();
+	double vesc	= solar_model.Local_Escape_Speed(solar_model.Radial_Grid_Lookup(event.Radius()));
+	Trajectory_Record record;
+	record.trajectory = 0;
+	record.time		  = event.time;
+	for(int i = 0; i < 3; i++)
+	{
+		record.position[i] = event.position[i];
+		record.velocity[i] = event.velocity[i];
+	}
+	record.energy = 1.0 / DM.mass * (v * v - vesc * vesc);
+	trajectory_records.push_back(record);
+}
+
 int Trajectory_Simulator::Sample_Target(obscura::DM_Particle& DM, double r, double DM_speed)
 {
 	if(r > rSun)
@@ -142,24 +230,16 @@ int Trajectory_Simulator::Sample_Target(obscura::DM_Particle& DM, double r, doub
 	}
 	else
 	{
-		std::vector<double> rate_nuclei;
-		for(unsigned int i = 0; i < solar_model.target_isotopes.size(); i++)
-			rate_nuclei.push_back(solar_model.DM_Scattering_Rate_Nucleus(DM, r, DM_speed, i));
-		double rate_electron = solar_model.DM_Scattering_Rate_Electron(DM, r, DM_speed);
-		double total_rate	 = std::accumulate(rate_nuclei.begin(), rate_nuclei.end(), rate_electron);
-
-		double xi = libphysica::Sample_Uniform(PRNG);
-		// Electron
-		double sum = rate_electron / total_rate;
-		if(sum > xi)
-			return -1;
-		// Nuclei
-		for(unsigned int i = 0; i < solar_model.target_isotopes.size(); i++)
-		{
-			sum += rate_nuclei[i] / total_rate;
-			if(sum > xi)
-				return i;
-		}
+		if(tabulated_target_selection && solar_model.Target_Fractions_Tabulated(DM_speed))
+			return solar_model.Sample_Target_Tabulated(r, DM_speed, libphysica::Sample_Uniform(PRNG));
+
+		// Sample the target from the cumulative rates, where the electron rate comes first.
+		solar_model.DM_Scattering_Rates(DM, solar_model.Radial_Grid_Lookup(r), DM_speed, target_rates);
+		std::partial_sum(target_rates.begin(), target_rates.end(), target_rates.begin());
+		double xi		   = libphysica::Sample_Uniform(PRNG) * target_rates.back();
+		unsigned int index = std::upper_bound(target_rates.begin(), target_rates.end(), xi) - target_rates.begin();
+		if(index < target_rates.size())
+			return static_cast<int>(index) - 1;
 		std::cerr << "Error in Trajectory_Simulator::Sample_Target(): No target could be sampled." << std::endl;
 		std::exit(EXIT_FAILURE);
 	}
@@ -235,7 +315,7 @@ void Trajectory_Simulator::Scatter(Event& current_event, obscura::DM_Particle& D
 	else
 		target_mass = solar_model.target_isotopes[target_index].mass;
 
-	libphysica::Vector vel_target = Sample_Target_Velocity(solar_model.Temperature(r), target_mass, current_event.velocity);
+	libphysica::Vector vel_target = Sample_Target_Velocity(solar_model.Temperature(solar_model.Radial_Grid_Lookup(r)), target_mass, current_event.velocity);
 
 	// 2. Sample the scattering angle
 	double cos_alpha = (target_index == -1) ? DM.Sample_Scattering_Angle_Electron(PRNG, v, r) : DM.Sample_Scattering_Angle_Nucleus(PRNG, solar_model.target_isotopes[target_index], v, r);
@@ -244,11 +324,86 @@ void Trajectory_Simulator::Scatter(Event& current_event, obscura::DM_Particle& D
 	current_event.velocity = New_DM_Velocity(cos_alpha, DM.mass, target_mass, current_event.velocity, vel_target);
 }
 
-void Trajectory_Simulator::Toggle_Trajectory_Saving(unsigned int max_trajectories)
+bool Trajectory_Simulator::Diffusion_Step(Event& current_event, obscura::DM_Particle& DM, unsigned long int& number_of_scatterings)
+{
+	// 1. Check for the diffusive regime of a bound particle with a mean free path much shorter than the scale height.
+	double r = current_event.Radius();
+	if(r > rSun)
+		return false;
+	Radial_Grid_Point point = solar_model.Radial_Grid_Lookup(r);
+	if(current_event.Speed() > solar_model.Local_Escape_Speed(point))
+		return false;
+	double temperature	  = solar_model.Temperature(point);
+	double v_mean		  = sqrt(8.0 * temperature / M_PI / DM.mass);
+	double mean_free_path = v_mean / solar_model.Total_DM_Scattering_Rate(DM, r, v_mean);
+	double scale_height	  = solar_model.Scale_Height(point);
+	if(mean_free_path > diffusion_mean_free_path_ratio * scale_height)
+		return false;
+
+	// 2. Number of collisions, whose random walk has an rms displacement of diffusion_step_ratio times the scale height, <R^2> = 2 N lambda^2.
+	double collisions = 0.5 * pow(diffusion_step_ratio * scale_height / mean_free_path, 2.0);
+	collisions		  = std::min(collisions, 1.0 * (maximum_scatterings - number_of_scatterings));
+	if(collisions < 2.0)
+		return false;
+	unsigned long int N = collisions;
+
+	// 3. Gaussian displacement with the diffusion coefficient D = lambda v / 3 plus the gravitational drift given by the Einstein relation
+	double duration				= N * mean_free_path / v_mean;
+	double diffusion_constant	= mean_free_path * v_mean / 3.0;
+	double drift				= -diffusion_constant * DM.mass * G_Newton * solar_model.Mass(point) / r / r / temperature * duration;
+	double sigma_x				= sqrt(2.0 * diffusion_constant * duration);
+	libphysica::Vector position	= current_event.position + drift * current_event.position.Normalized();
+	// The step must stay inside the Sun, which is checked before drawing any random numbers, such that a rejected step leaves the random number stream untouched.
+	if(position.Norm() + 5.0 * sigma_x > rSun)
+		return false;
+	std::normal_distribution<double> gaussian(0.0, 1.0);
+	for(int i = 0; i < 3; i++)
+		position[i] += sigma_x * gaussian(PRNG);
+	// Displacements beyond five standard deviations are mirrored at the solar surface.
+	if(position.Norm() > rSun)
+		position = (2.0 * rSun / position.Norm() - 1.0) * position;
+
+	// 4. The particle leaves the diffusion step thermalized with the local gas.
+	double sigma_v = sqrt(solar_model.Temperature(solar_model.Radial_Grid_Lookup(position.Norm())) / DM.mass);
+	libphysica::Vector velocity({sigma_v * gaussian(PRNG), sigma_v * gaussian(PRNG), sigma_v * gaussian(PRNG)});
+	current_event = Event(current_event.time + duration, position, velocity);
+	number_of_scatterings += N;
+	diffusion_steps++;
+	if(saving_current_trajectory)
+		Save_Event(current_event, DM);
+	return true;
+}
+
+bool Trajectory_Simulator::Particle_Trapped(const Event& current_event, obscura::DM_Particle& DM) const
+{
+	double u_sqr = current_event.Asymptotic_Speed_Sqr(solar_model);
+	if(u_sqr >= 0.0)
+		return false;
+	// A collision with a thermal target transfers at most the target's kinetic energy, which hardly ever exceeds ten times the core temperature.
+	double energy_deficit  = 0.5 * DM.mass * (-u_sqr - 2.0 * G_Newton * mSun / maximum_distance);
+	double energy_gain_max = 10.0 * maximum_temperature;
+	return energy_deficit > capture_collisions * energy_gain_max;
+}
+
+void Trajectory_Simulator::Toggle_Trajectory_Saving(unsigned int max_trajectories, unsigned int stride, unsigned int simulator_index)
 {
 	saved_trajectories	   = 0;
 	saved_trajectories_max = max_trajectories;
+	saving_stride		   = (stride == 0) ? 1 : stride;
 	save_trajectories	   = !save_trajectories;
+	if(save_trajectories && trajectory_writer == nullptr)
+	{
+		int mpi_initialized, mpi_rank = 0;
+		MPI_Initialized(&mpi_initialized);
+		if(mpi_initialized)
+			MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+		trajectory_writer = std::make_shared<Trajectory_Writer>(TOP_LEVEL_DIR "results/trajectories_" + std::to_string(mpi_rank) + "_" + std::to_string(simulator_index) + ".bin");
+	}
+}
+
+void Trajectory_Simulator::Set_Trajectory_Writer(std::shared_ptr<Trajectory_Writer> writer)
+{
+	trajectory_writer = writer;
 }
 
 void Trajectory_Simulator::Fix_PRNG_Seed(int fixed_seed)
@@ -256,30 +411,108 @@ void Trajectory_Simulator::Fix_PRNG_Seed(int fixed_seed)
 	PRNG.seed(fixed_seed);
 }
 
-Trajectory_Result Trajectory_Simulator::Simulate(const Event& initial_condition, obscura::DM_Particle& DM)
+unsigned long int Trajectory_Simulator::Diffusion_Steps() const
 {
-	std::ofstream f;
-	if(save_trajectories && saved_trajectories < saved_trajectories_max)
-	{
-		saved_trajectories++;
-		std::string path = TOP_LEVEL_DIR "results/";
-		f.open(path + "trajectory_" + std::to_string(saved_trajectories) + ".txt");
-	}
-	Event current_event						= initial_condition;
-	long unsigned int number_of_scatterings = 0;
-	while(Propagate_Freely(current_event, DM, f) && number_of_scatterings < maximum_scatterings)
+	return diffusion_steps;
+}
+
+unsigned long int Trajectory_Simulator::Short_Circuited_Trajectories() const
+{
+	return short_circuited_trajectories;
+}
+
+unsigned int Trajectory_Simulator::Splitting_Level(const Event& event) const
+{
+	double u = sqrt(std::max(0.0, event.Asymptotic_Speed_Sqr(solar_model)));
+	return std::upper_bound(splitting_speeds.begin(), splitting_speeds.end(), u) - splitting_speeds.begin();
+}
+
+Trajectory_Result Trajectory_Simulator::Continue_Trajectory(Split_Particle particle, obscura::DM_Particle& DM)
+{
+	Event& current_event					 = particle.current_event;
+	long unsigned int& number_of_scatterings = particle.number_of_scatterings;
+	while(Propagate_Freely(current_event, DM) && number_of_scatterings < maximum_scatterings)
 	{
 		if(current_event.Radius() < rSun)
 		{
+			bool first_scattering = (number_of_scatterings == 0);
 			Scatter(current_event, DM);
 			number_of_scatterings++;
+			if(diffusion_acceleration && number_of_scatterings < maximum_scatterings)
+				Diffusion_Step(current_event, DM, number_of_scatterings);
+			if(capture_short_circuit && Particle_Trapped(current_event, DM))
+			{
+				short_circuited_trajectories++;
+				break;
+			}
+			if(!splitting_speeds.empty())
+			{
+				// The first scattering only sets the level, so that fast incoming particles are not killed before they did anything.
+				unsigned int splitting_level = Splitting_Level(current_event);
+				if(first_scattering)
+					particle.splitting_level = splitting_level;
+				else if(splitting_level > particle.splitting_level)
+				{
+					unsigned int copies		 = pow(splitting_factor, splitting_level - particle.splitting_level);
+					particle.splitting_level = splitting_level;
+					particle.weight /= copies;
+					for(unsigned int i = 1; i < copies; i++)
+						split_particles.push_back(particle);
+				}
+				else if(splitting_level < particle.splitting_level)
+				{
+					double survival_probability	= pow(splitting_factor, -1.0 * (particle.splitting_level - splitting_level));
+					particle.splitting_level	= splitting_level;
+					if(libphysica::Sample_Uniform(PRNG) > survival_probability)
+					{
+						particle.weight = 0.0;
+						break;
+					}
+					particle.weight /= survival_probability;
+				}
+			}
 		}
 		else
 			break;
 	}
-	if(save_trajectories)
-		f.close();
-	return Trajectory_Result(initial_condition, current_event, number_of_scatterings);
+	return Trajectory_Result(particle.initial_event, current_event, number_of_scatterings, particle.weight);
+}
+
+Trajectory_Result Trajectory_Simulator::Simulate(const Event& initial_condition, obscura::DM_Particle& DM)
+{
+	saving_current_trajectory = save_trajectories && saved_trajectories < saved_trajectories_max;
+	if(saving_current_trajectory)
+	{
+		saved_trajectories++;
+		trajectory_records.clear();
+		Save_Event(initial_condition, DM);
+	}
+	split_particles.clear();
+	Trajectory_Result result = Continue_Trajectory(Split_Particle{initial_condition, initial_condition, 0, 0, 1.0}, DM);
+	if(saving_current_trajectory)
+	{
+		Save_Event(result.final_event, DM);
+		trajectory_writer->Write_Trajectory(trajectory_records);
+		saving_current_trajectory = false;
+	}
+	return result;
+}
+
+bool Trajectory_Simulator::Split_Particles_Pending() const
+{
+	return !split_particles.empty();
+}
+
+Trajectory_Result Trajectory_Simulator::Simulate_Split_Particle(obscura::DM_Particle& DM)
+{
+	if(split_particles.empty())
+	{
+		std::cerr << "Error in Trajectory_Simulator::Simulate_Split_Particle(): No split particles left." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	Split_Particle particle = split_particles.back();
+	split_particles.pop_back();
+	return Continue_Trajectory(particle, DM);
 }
 
 // 3. Equation of motion solution with Runge-Kutta-Fehlberg
@@ -297,8 +530,19 @@ Free_Particle_Propagator::Free_Particle_Propagator(const Event& event)
 	v_radial		 = (radius == 0) ? event.Speed() : event.position.Dot(event.velocity) / radius;
 	angular_momentum = (event.position.Cross(event.velocity)).Dot(axis_z);
 
+	time_previous	  = time;
+	radius_previous	  = radius;
+	phi_previous	  = phi;
+	v_radial_previous = v_radial;
+
 	// 3. Error tolerances
-	error_tolerances = {1.0 * km, 1.0e-3 * km / sec, 1.0e-7};
+	error_tolerances[0]	= 1.0 * km;
+	error_tolerances[1]	= 1.0e-3 * km / sec;
+	error_tolerances[2]	= 1.0e-7;
+
+	// 4. Step statistics
+	accepted_steps = 0;
+	rejected_steps = 0;
 }
 
 double Free_Particle_Propagator::dr_dt(double v)
@@ -323,60 +567,66 @@ void Free_Particle_Propagator::Runge_Kutta_45_Step(double mass)
 	double k_v[6];
 	double k_p[6];
 
-	k_r[0] = time_step * dr_dt(v_radial);
-	k_v[0] = time_step * dv_dt(radius, mass);
-	k_p[0] = time_step * dphi_dt(radius);
-
-	k_r[1] = time_step * dr_dt(v_radial + k_v[0] / 4.0);
-	k_v[1] = time_step * dv_dt(radius + k_r[0] / 4.0, mass);
-	// k_p[1]=	dt*dphi_dt(radius+k_r[0]/4.0,J);
-
-	k_r[2] = time_step * dr_dt(v_radial + 3.0 / 32.0 * k_v[0] + 9.0 / 32.0 * k_v[1]);
-	k_v[2] = time_step * dv_dt(radius + 3.0 / 32.0 * k_r[0] + 9.0 / 32.0 * k_r[1], mass);
-	k_p[2] = time_step * dphi_dt(radius + 3.0 / 32.0 * k_r[0] + 9.0 / 32.0 * k_r[1]);
-
-	k_r[3] = time_step * dr_dt(v_radial + 1932.0 / 2197.0 * k_v[0] - 7200.0 / 2197.0 * k_v[1] + 7296.0 / 2197.0 * k_v[2]);
-	k_v[3] = time_step * dv_dt(radius + 1932.0 / 2197.0 * k_r[0] - 7200.0 / 2197.0 * k_r[1] + 7296.0 / 2197.0 * k_r[2], mass);
-	k_p[3] = time_step * dphi_dt(radius + 1932.0 / 2197.0 * k_r[0] - 7200.0 / 2197.0 * k_r[1] + 7296.0 / 2197.0 * k_r[2]);
-
-	k_r[4] = time_step * dr_dt(v_radial + 439.0 / 216.0 * k_v[0] - 8.0 * k_v[1] + 3680.0 / 513.0 * k_v[2] - 845.0 / 4104.0 * k_v[3]);
-	k_v[4] = time_step * dv_dt(radius + 439.0 / 216.0 * k_r[0] - 8.0 * k_r[1] + 3680.0 / 513.0 * k_r[2] - 845.0 / 4104.0 * k_r[3], mass);
-	k_p[4] = time_step * dphi_dt(radius + 439.0 / 216.0 * k_r[0] - 8.0 * k_r[1] + 3680.0 / 513.0 * k_r[2] - 845.0 / 4104.0 * k_r[3]);
-
-	k_r[5] = time_step * dr_dt(v_radial - 8.0 / 27.0 * k_v[0] + 2.0 * k_v[1] - 3544.0 / 2565.0 * k_v[2] + 1859.0 / 4104.0 * k_v[3] - 11.0 / 40.0 * k_v[4]);
-	k_v[5] = time_step * dv_dt(radius - 8.0 / 27.0 * k_r[0] + 2.0 * k_r[1] - 3544.0 / 2565.0 * k_r[2] + 1859.0 / 4104.0 * k_r[3] - 11.0 / 40.0 * k_r[4], mass);
-	k_p[5] = time_step * dphi_dt(radius - 8.0 / 27.0 * k_r[0] + 2.0 * k_r[1] - 3544.0 / 2565.0 * k_r[2] + 1859.0 / 4104.0 * k_r[3] - 11.0 / 40.0 * k_r[4]);
+	// Rejected steps are repeated with the adapted time step until the errors fall below the tolerances.
+	for(unsigned int rejections = 0;; rejections++)
+	{
+		double dt = time_step;
 
-	// New values with Runge Kutta 4 and Runge Kutta 5
-	double radius_4	  = radius + 25.0 / 216.0 * k_r[0] + 1408.0 / 2565.0 * k_r[2] + 2197.0 / 4101.0 * k_r[3] - 1.0 / 5.0 * k_r[4];
-	double v_radial_4 = v_radial + 25.0 / 216.0 * k_v[0] + 1408.0 / 2565.0 * k_v[2] + 2197.0 / 4101.0 * k_v[3] - 1.0 / 5.0 * k_v[4];
-	double phi_4	  = phi + 25.0 / 216.0 * k_p[0] + 1408.0 / 2565.0 * k_p[2] + 2197.0 / 4101.0 * k_p[3] - 1.0 / 5.0 * k_p[4];
+		for(unsigned int i = 0; i < 6; i++)
+		{
+			double radius_i	  = radius;
+			double v_radial_i = v_radial;
+			for(unsigned int j = 0; j < i; j++)
+			{
+				radius_i += RKF_a[i][j] * k_r[j];
+				v_radial_i += RKF_a[i][j] * k_v[j];
+			}
+			k_r[i] = dt * dr_dt(v_radial_i);
+			k_v[i] = dt * dv_dt(radius_i, mass);
+			k_p[i] = dt * dphi_dt(radius_i);
+		}
 
-	double radius_5	  = radius + 16.0 / 135.0 * k_r[0] + 6656.0 / 12825.0 * k_r[2] + 28561.0 / 56430.0 * k_r[3] - 9.0 / 50.0 * k_r[4] + 2.0 / 55.0 * k_r[5];
-	double v_radial_5 = v_radial + 16.0 / 135.0 * k_v[0] + 6656.0 / 12825.0 * k_v[2] + 28561.0 / 56430.0 * k_v[3] - 9.0 / 50.0 * k_v[4] + 2.0 / 55.0 * k_v[5];
-	double phi_5	  = phi + 16.0 / 135.0 * k_p[0] + 6656.0 / 12825.0 * k_p[2] + 28561.0 / 56430.0 * k_p[3] - 9.0 / 50.0 * k_p[4] + 2.0 / 55.0 * k_p[5];
+		// New values with Runge Kutta 4 and Runge Kutta 5
+		double radius_4	  = radius;
+		double v_radial_4 = v_radial;
+		double phi_4	  = phi;
+		double radius_5	  = radius;
+		double v_radial_5 = v_radial;
+		double phi_5	  = phi;
+		for(unsigned int i = 0; i < 6; i++)
+		{
+			radius_4 += RKF_b_4[i] * k_r[i];
+			v_radial_4 += RKF_b_4[i] * k_v[i];
+			phi_4 += RKF_b_4[i] * k_p[i];
+			radius_5 += RKF_b_5[i] * k_r[i];
+			v_radial_5 += RKF_b_5[i] * k_v[i];
+			phi_5 += RKF_b_5[i] * k_p[i];
+		}
 
-	// Error and adapting the time step
-	std::vector<double> errors = {fabs(radius_5 - radius_4), fabs(v_radial_5 - v_radial_4), fabs(phi_5 - phi_4)};
-	std::vector<double> deltas;
-	for(int i = 0; i < 3; i++)
-		deltas.push_back(0.84 * pow(error_tolerances[i] / errors[i], 1.0 / 4.0));
-	double delta		 = *std::min_element(std::begin(deltas), std::end(deltas));
-	double time_step_new = delta * time_step;
+		// Error and adapting the time step
+		// The fourth root is monotonic, so the smallest ratio tolerance / error determines the step size and whether all errors fall below the tolerances.
+		double ratio_r	 = error_tolerances[0] / fabs(radius_5 - radius_4);
+		double ratio_v	 = error_tolerances[1] / fabs(v_radial_5 - v_radial_4);
+		double ratio_phi = error_tolerances[2] / fabs(phi_5 - phi_4);
+		double ratio_min = std::min(ratio_r, std::min(ratio_v, ratio_phi));
+		time_step		 = 0.84 * sqrt(sqrt(ratio_min)) * dt;
 
-	// Check if errors fall below the tolerance
-	if(errors[0] < error_tolerances[0] && errors[1] < error_tolerances[1] && errors[2] < error_tolerances[2])
-	{
-		time	  = time + time_step;
-		radius	  = radius_4;
-		v_radial  = v_radial_4;
-		phi		  = phi_4;
-		time_step = time_step_new;
-	}
-	else
-	{
-		time_step = time_step_new;
-		Runge_Kutta_45_Step(mass);
+		if(ratio_min > 1.0 || rejections == maximum_step_rejections)
+		{
+			if(ratio_min <= 1.0)
+				std::cerr << "Warning in Free_Particle_Propagator::Runge_Kutta_45_Step(): Step accepted after " << rejections << " rejections without reaching the error tolerance." << std::endl;
+			time_previous	  = time;
+			radius_previous	  = radius;
+			v_radial_previous = v_radial;
+			phi_previous	  = phi;
+			time			  = time + dt;
+			radius			  = radius_4;
+			v_radial = v_radial_4;
+			phi		 = phi_4;
+			accepted_steps++;
+			return;
+		}
+		rejected_steps++;
 	}
 }
 
@@ -398,6 +648,54 @@ double Free_Particle_Propagator::Current_Speed()
 		return sqrt(v_radial * v_radial + angular_momentum * angular_momentum / radius / radius);
 }
 
+void Free_Particle_Propagator::Interpolate_Coordinates(double fraction, double& r, double& v_r, double& phi_interpolated) const
+{
+	// Cubic Hermite polynomials, which match the coordinates and their time derivatives at both ends of the step.
+	double dt		 = time - time_previous;
+	double s		 = fraction;
+	double h_00		 = 2.0 * s * s * s - 3.0 * s * s + 1.0;
+	double h_10		 = s * s * s - 2.0 * s * s + s;
+	double h_01		 = -2.0 * s * s * s + 3.0 * s * s;
+	double h_11		 = s * s * s - s * s;
+	r				 = h_00 * radius_previous + h_10 * dt * v_radial_previous + h_01 * radius + h_11 * dt * v_radial;
+	v_r				 = (6.0 * s * s - 6.0 * s) * (radius_previous - radius) / dt + (3.0 * s * s - 4.0 * s + 1.0) * v_radial_previous + (3.0 * s * s - 2.0 * s) * v_radial;
+	double w_0		 = angular_momentum / radius_previous / radius_previous;
+	double w_1		 = angular_momentum / radius / radius;
+	phi_interpolated = h_00 * phi_previous + h_10 * dt * w_0 + h_01 * phi + h_11 * dt * w_1;
+}
+
+void Free_Particle_Propagator::Interpolate_Last_Step(double fraction, double& r, double& v) const
+{
+	double v_r, phi_interpolated;
+	Interpolate_Coordinates(fraction, r, v_r, phi_interpolated);
+	v = sqrt(v_r * v_r + angular_momentum * angular_momentum / r / r);
+}
+
+void Free_Particle_Propagator::Rewind_Last_Step(double fraction)
+{
+	double r, v_r, phi_interpolated;
+	Interpolate_Coordinates(fraction, r, v_r, phi_interpolated);
+	time	 = time_previous + fraction * (time - time_previous);
+	radius	 = r;
+	v_radial = v_r;
+	phi		 = phi_interpolated;
+}
+
+double Free_Particle_Propagator::Last_Time_Step() const
+{
+	return time - time_previous;
+}
+
+unsigned long int Free_Particle_Propagator::Accepted_Steps() const
+{
+	return accepted_steps;
+}
+
+unsigned long int Free_Particle_Propagator::Rejected_Steps() const
+{
+	return rejected_steps;
+}
+
 Event Free_Particle_Propagator::Event_In_3D()
 {
 	double v_phi			= angular_momentum / pow(radius, 2);
@@ -1,9 +1,12 @@
 #include "Simulation_Utilities.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 
 #include "libphysica/Special_Functions.hpp"
 #include "libphysica/Statistics.hpp"
+#include "libphysica/Utilities.hpp"
 
 #include "obscura/DM_Halo_Models.hpp"
 
@@ -38,7 +41,7 @@ double Event::Angular_Momentum() const
 	return position.Cross(velocity).Norm();
 }
 
-double Event::Asymptotic_Speed_Sqr(Solar_Model& solar_model) const
+double Event::Asymptotic_Speed_Sqr(const Solar_Model& solar_model) const
 {
 	double r	 = Radius();
 	double v	 = Speed();
@@ -81,7 +84,7 @@ std::ostream& operator<<(std::ostream& output, const Event& event)
 }
 
 // 2. Generator of initial conditions
-double PDF_Initial_Speed(double v, obscura::DM_Distribution& halo_model, Solar_Model& solar_model)
+double PDF_Initial_Speed(double v, obscura::DM_Distribution& halo_model, const Solar_Model& solar_model)
 {
 	double v_esc			 = solar_model.Local_Escape_Speed(rSun);
 	double v_average		 = halo_model.Average_Speed();
@@ -101,7 +104,39 @@ double PDF_Cos_Theta(double cos_theta, double v, obscura::DM_Distribution& halo_
 	return normalization * halo_model.PDF_Velocity(vel);
 }
 
-Event Initial_Conditions(obscura::DM_Distribution& halo_model, Solar_Model& solar_model, std::mt19937& PRNG)
+// Construct the initial event far away from the Sun for a given asymptotic speed u and angle theta to the Sun's velocity
+static Event Initial_Event(double u, double cos_theta, const libphysica::Vector& vel_sun, double v_esc_sun, double v_esc_asymptotic, double asymptotic_distance, std::mt19937& PRNG, double impact_parameter_bias, double& weight)
+{
+	// 1. Initial velocity
+	double phi							= libphysica::Sample_Uniform(PRNG, 0.0, 2.0 * M_PI);
+	libphysica::Vector initial_velocity = libphysica::Spherical_Coordinates(u, acos(cos_theta), phi, vel_sun);
+
+	// Blue-shift the speed
+	double v		 = sqrt(u * u + v_esc_asymptotic * v_esc_asymptotic);
+	initial_velocity = v * initial_velocity.Normalized();
+
+	// 2. Initial position
+	// 2.1 Find the maximum impact parameter such that the particle still hits the Sun.
+	double impact_parameter_max = sqrt(u * u + v_esc_sun * v_esc_sun) / v * rSun;
+	libphysica::Vector e_z		= (-1.0) * initial_velocity.Normalized();
+	libphysica::Vector e_x({0, e_z[2], -e_z[1]});
+	e_x.Normalize();
+	libphysica::Vector e_y = e_z.Cross(e_x);
+
+	// 2.2 Find a random point in the plane.
+	double phi_disk						= libphysica::Sample_Uniform(PRNG, 0.0, 2.0 * M_PI);
+	double xi							= libphysica::Sample_Uniform(PRNG, 0.0, 1.0);
+	double impact_parameter_sqr			= pow(xi, impact_parameter_bias);	// uniform in the disk without bias
+	double impact_parameter				= sqrt(impact_parameter_sqr) * impact_parameter_max;
+	libphysica::Vector initial_position = asymptotic_distance * e_z + impact_parameter * (cos(phi_disk) * e_x + sin(phi_disk) * e_y);
+
+	// 3. Weight of the biased impact parameter
+	weight *= impact_parameter_bias * pow(impact_parameter_sqr, 1.0 - 1.0 / impact_parameter_bias);
+
+	return Event(0.0, initial_position, initial_velocity);
+}
+
+Event Initial_Conditions(obscura::DM_Distribution& halo_model, const Solar_Model& solar_model, std::mt19937& PRNG)
 {
 	// 1. Initial velocity
 	// 1.1. Sample initial speed u asymptotically far from the Sun.
@@ -124,32 +159,122 @@ Event Initial_Conditions(obscura::DM_Distribution& halo_model, Solar_Model& sola
 	double cos_theta = libphysica::Rejection_Sampling(pdf_cos_theta, -1.0, cos_theta_max, y_max, PRNG);
 	// double cos_theta = libphysica::Sample_Uniform(PRNG,-1.0,1.0);// to test isotropic initial conditions
 
-	// 1.3. Construct velocity vector
-	double phi							= libphysica::Sample_Uniform(PRNG, 0.0, 2.0 * M_PI);
-	libphysica::Vector initial_velocity = libphysica::Spherical_Coordinates(u, acos(cos_theta), phi, vel_sun);
-
-	// 1.4. Blue-shift the speed
+	// 2. Construct the initial event
 	double asymptotic_distance = 1000.0 * AU;
-	double vesc_asymptotic	   = solar_model.Local_Escape_Speed(asymptotic_distance);
-	double v				   = sqrt(u * u + vesc_asymptotic * vesc_asymptotic);
-	initial_velocity		   = v * initial_velocity.Normalized();
+	double weight			   = 1.0;
+	return Initial_Event(u, cos_theta, vel_sun, solar_model.Local_Escape_Speed(rSun), solar_model.Local_Escape_Speed(asymptotic_distance), asymptotic_distance, PRNG, 1.0, weight);
+}
 
-	// 2. Initial position
-	// 2.1 Find the maximum impact parameter such that the particle still hits the Sun.
-	double v_esc				= solar_model.Local_Escape_Speed(rSun);
-	double impact_parameter_max = sqrt(u * u + v_esc * v_esc) / v * rSun;
-	libphysica::Vector e_z		= (-1.0) * initial_velocity.Normalized();
-	libphysica::Vector e_x({0, e_z[2], -e_z[1]});
-	e_x.Normalize();
-	libphysica::Vector e_y = e_z.Cross(e_x);
+Initial_Conditions_Generator::Initial_Conditions_Generator(obscura::DM_Distribution& halo_model, const Solar_Model& solar_model, unsigned int speed_grid_points, unsigned int cos_theta_grid_points)
+: speed_bias_exponent(0.0), impact_parameter_bias(1.0), speed_bias_normalization(1.0)
+{
+	vel_sun				= dynamic_cast<obscura::Standard_Halo_Model*>(&halo_model)->Get_Observer_Velocity();
+	v_gal				= halo_model.Maximum_DM_Speed() - vel_sun.Norm();
+	asymptotic_distance	= 1000.0 * AU;
+	v_esc_sun			= solar_model.Local_Escape_Speed(rSun);
+	v_esc_asymptotic	= solar_model.Local_Escape_Speed(asymptotic_distance);
+
+	// 1. Speed CDF
+	// The normalization of PDF_Initial_Speed() cancels in the CDF, so we only need the speed-dependent factor.
+	speeds = libphysica::Linear_Space(halo_model.Minimum_DM_Speed(), halo_model.Maximum_DM_Speed(), speed_grid_points);
+	for(auto& v : speeds)
+		speed_pdf.push_back((v > 0.0) ? halo_model.PDF_Speed(v) * (v + v_esc_sun * v_esc_sun / v) : 0.0);
+	speed_cdf = {0.0};
+	for(unsigned int i = 1; i < speeds.size(); i++)
+		speed_cdf.push_back(speed_cdf.back() + 0.5 * (speed_pdf[i - 1] + speed_pdf[i]) * (speeds[i] - speeds[i - 1]));
+	for(auto& cdf : speed_cdf)
+		cdf /= speed_cdf.back();
+	biased_speed_cdf = speed_cdf;
+
+	// 2. Conditional CDFs of cos(theta)
+	cos_theta_speeds = libphysica::Linear_Space(halo_model.Minimum_DM_Speed(), halo_model.Maximum_DM_Speed(), cos_theta_grid_points);
+	cos_theta_x		 = libphysica::Linear_Space(0.0, 1.0, cos_theta_grid_points);
+	for(auto& u : cos_theta_speeds)
+	{
+		double cos_theta_max = Cos_Theta_Max(u);
+		std::vector<double> pdf_cos_theta;
+		for(auto& x : cos_theta_x)
+		{
+			double pdf = (u > 0.0) ? PDF_Cos_Theta(-1.0 + x * (cos_theta_max + 1.0), u, halo_model) : 0.0;
+			pdf_cos_theta.push_back(std::isfinite(pdf) ? pdf : 0.0);
+		}
+		std::vector<double> cdf = {0.0};
+		for(unsigned int i = 1; i < cos_theta_x.size(); i++)
+			cdf.push_back(cdf.back() + 0.5 * (pdf_cos_theta[i - 1] + pdf_cos_theta[i]) * (cos_theta_x[i] - cos_theta_x[i - 1]));
+		// Fall back to a uniform distribution where the pdf vanishes, e.g. at the boundaries of the speed domain.
+		for(unsigned int i = 0; i < cdf.size(); i++)
+			cdf[i] = (cdf.back() > 0.0) ? cdf[i] / cdf.back() : cos_theta_x[i];
+		cos_theta_cdfs.push_back(cdf);
+	}
+}
 
-	// 2.2 Find a random point in the plane.
-	double phi_disk						= libphysica::Sample_Uniform(PRNG, 0.0, 2.0 * M_PI);
-	double xi							= libphysica::Sample_Uniform(PRNG, 0.0, 1.0);
-	double impact_parameter				= sqrt(xi) * impact_parameter_max;
-	libphysica::Vector initial_position = asymptotic_distance * e_z + impact_parameter * (cos(phi_disk) * e_x + sin(phi_disk) * e_y);
+double Initial_Conditions_Generator::Cos_Theta_Max(double u) const
+{
+	double v_sun = vel_sun.Norm();
+	return std::max(-1.0, std::min(1.0, (v_gal * v_gal - v_sun * v_sun - u * u) / (2.0 * u * v_sun)));
+}
 
-	return Event(0.0, initial_position, initial_velocity);
+double Initial_Conditions_Generator::Inverse_CDF(const std::vector<double>& grid, const std::vector<double>& cdf, double xi) const
+{
+	unsigned int i = std::upper_bound(cdf.begin(), cdf.end(), xi) - cdf.begin();
+	if(i == 0)
+		return grid.front();
+	else if(i == cdf.size())
+		return grid.back();
+	double delta_cdf = cdf[i] - cdf[i - 1];
+	return (delta_cdf > 0.0) ? grid[i - 1] + (xi - cdf[i - 1]) / delta_cdf * (grid[i] - grid[i - 1]) : grid[i - 1];
+}
+
+void Initial_Conditions_Generator::Set_Importance_Sampling(double speed_exponent, double impact_parameter_exponent)
+{
+	if(impact_parameter_exponent <= 0.0)
+	{
+		std::cerr << "Error in Initial_Conditions_Generator::Set_Importance_Sampling(): The impact parameter exponent must be positive." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	speed_bias_exponent	  = speed_exponent;
+	impact_parameter_bias = impact_parameter_exponent;
+
+	// The biased speed CDF with the normalization relative to the physical one, which enters the weights.
+	std::vector<double> biased_pdf;
+	for(unsigned int i = 0; i < speeds.size(); i++)
+		biased_pdf.push_back(speed_pdf[i] * pow(speeds[i] / speeds.back(), speed_bias_exponent));
+	std::vector<double> cdf = {0.0};
+	double normalization	= 0.0;
+	for(unsigned int i = 1; i < speeds.size(); i++)
+	{
+		cdf.push_back(cdf.back() + 0.5 * (biased_pdf[i - 1] + biased_pdf[i]) * (speeds[i] - speeds[i - 1]));
+		normalization += 0.5 * (speed_pdf[i - 1] + speed_pdf[i]) * (speeds[i] - speeds[i - 1]);
+	}
+	speed_bias_normalization = cdf.back() / normalization;
+	for(auto& entry : cdf)
+		entry /= cdf.back();
+	biased_speed_cdf = cdf;
+}
+
+Event Initial_Conditions_Generator::Initial_Conditions(std::mt19937& PRNG) const
+{
+	double weight = 1.0;
+	return Initial_Conditions(PRNG, weight);
+}
+
+Event Initial_Conditions_Generator::Initial_Conditions(std::mt19937& PRNG, double& event_weight) const
+{
+	// 1. Initial velocity
+	// 1.1. Sample initial speed u asymptotically far from the Sun.
+	double u	 = Inverse_CDF(speeds, biased_speed_cdf, libphysica::Sample_Uniform(PRNG, 0.0, 1.0));
+	event_weight = (speed_bias_exponent == 0.0) ? 1.0 : speed_bias_normalization / pow(u / speeds.back(), speed_bias_exponent);
+
+	// 1.2. Sample cos(theta) by interpolating the inverse conditional CDFs of the neighbouring speeds.
+	double xi		  = libphysica::Sample_Uniform(PRNG, 0.0, 1.0);
+	double speed_step = cos_theta_speeds[1] - cos_theta_speeds[0];
+	unsigned int i	  = std::min<unsigned int>(cos_theta_speeds.size() - 2, (u - cos_theta_speeds.front()) / speed_step);
+	double weight	  = (u - cos_theta_speeds[i]) / speed_step;
+	double x		  = (1.0 - weight) * Inverse_CDF(cos_theta_x, cos_theta_cdfs[i], xi) + weight * Inverse_CDF(cos_theta_x, cos_theta_cdfs[i + 1], xi);
+	double cos_theta  = -1.0 + x * (Cos_Theta_Max(u) + 1.0);
+
+	// 2. Construct the initial event
+	return Initial_Event(u, cos_theta, vel_sun, v_esc_sun, v_esc_asymptotic, asymptotic_distance, PRNG, impact_parameter_bias, event_weight);
 }
 
 // 3. Analytically propagate a particle at event on a hyperbolic Kepler orbit to a radius R (without passing the periapsis)
@@ -199,6 +324,80 @@ void Hyperbolic_Kepler_Shift(Event& event, double R_final)
 	event.velocity = sqrt(G_Newton * mSun / semilatus_rectum) * (eccentricity * sin(theta_final) * event.position.Normalized() + (1.0 + eccentricity * cos(theta_final)) * axis_z.Cross(event.position.Normalized()));
 }
 
+// Time since the periapsis passage as a function of the orbital angle theta (Kepler's equation)
+static double Kepler_Time(double theta, double eccentricity, double semilatus_rectum)
+{
+	if(eccentricity < 1.0)
+	{
+		double semi_major_axis = semilatus_rectum / (1.0 - eccentricity * eccentricity);
+		double period		   = 2.0 * M_PI * sqrt(pow(semi_major_axis, 3) / G_Newton / mSun);
+		// Reduce the angle to [-pi,pi) and count the completed revolutions.
+		double revolutions		 = floor((theta + M_PI) / 2.0 / M_PI);
+		double theta_reduced	 = theta - 2.0 * M_PI * revolutions;
+		double eccentric_anomaly = 2.0 * atan2(sqrt(1.0 - eccentricity) * sin(theta_reduced / 2.0), sqrt(1.0 + eccentricity) * cos(theta_reduced / 2.0));
+		double mean_anomaly		 = eccentric_anomaly - eccentricity * sin(eccentric_anomaly);
+		return period * (revolutions + mean_anomaly / 2.0 / M_PI);
+	}
+	else
+	{
+		double semi_major_axis	  = semilatus_rectum / (eccentricity * eccentricity - 1.0);
+		double hyperbolic_anomaly = 2.0 * atanh(sqrt((eccentricity - 1.0) / (eccentricity + 1.0)) * tan(theta / 2.0));
+		double mean_anomaly		  = eccentricity * sinh(hyperbolic_anomaly) - hyperbolic_anomaly;
+		return sqrt(pow(semi_major_axis, 3) / G_Newton / mSun) * mean_anomaly;
+	}
+}
+
+bool Kepler_Shift(Event& event, double R_final)
+{
+	// 1. Initial event
+	double R_initial		= event.Radius();
+	double v_initial		= event.Speed();
+	double angular_momentum = event.Angular_Momentum();
+
+	if(R_final < rSun || R_initial < rSun)
+	{
+		std::cerr << "Error in Kepler_Shift(): Orbits inside the Sun cannot be described analytically." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+
+	// 2. Kepler orbit parameter
+	double energy			= v_initial * v_initial / 2.0 - G_Newton * mSun / R_initial;
+	double semilatus_rectum	= angular_momentum * angular_momentum / G_Newton / mSun;
+	double eccentricity		= sqrt(std::max(0.0, 1.0 + 2.0 * energy * semilatus_rectum / G_Newton / mSun));
+	if(angular_momentum == 0.0 || eccentricity < 1.0e-8 || fabs(eccentricity - 1.0) < 1.0e-8)
+		return false;
+
+	// 3. Initial orbital angle, which is negative before and positive after the periapsis.
+	double cos_theta_initial = std::min(1.0, std::max(-1.0, (semilatus_rectum / R_initial - 1.0) / eccentricity));
+	double theta_initial	 = libphysica::Sign(event.position.Dot(event.velocity)) * acos(cos_theta_initial);
+
+	// 4. Final orbital angle, i.e. the next angle after theta_initial with radius R_final
+	double cos_theta_final = (semilatus_rectum / R_final - 1.0) / eccentricity;
+	if(fabs(cos_theta_final) > 1.0)
+		return false;
+	std::array<double, 3> candidates  = {-acos(cos_theta_final), acos(cos_theta_final), 2.0 * M_PI - acos(cos_theta_final)};
+	unsigned int number_of_candidates = (eccentricity < 1.0) ? 3 : 2;
+	double theta_final				  = 4.0 * M_PI;
+	for(unsigned int i = 0; i < number_of_candidates; i++)
+		if(candidates[i] > theta_initial + 1.0e-10 && candidates[i] < theta_final)
+			theta_final = candidates[i];
+	if(theta_final > 2.0 * M_PI)
+		return false;
+
+	// 5. Axis vectors of orbital coordinate system
+	libphysica::Vector axis_z = event.position.Cross(event.velocity).Normalized();
+	libphysica::Vector axis_x = cos(theta_initial) * event.position.Normalized() + sin(theta_initial) * event.position.Normalized().Cross(axis_z);
+	libphysica::Vector axis_y = axis_z.Cross(axis_x);
+
+	// 6. Final time, position, and velocity
+	// 6.1 Time
+	event.time += Kepler_Time(theta_final, eccentricity, semilatus_rectum) - Kepler_Time(theta_initial, eccentricity, semilatus_rectum);
+	// 6.2 Position and Velocity
+	event.position = R_final * cos(theta_final) * axis_x + R_final * sin(theta_final) * axis_y;
+	event.velocity = sqrt(G_Newton * mSun / semilatus_rectum) * (eccentricity * sin(theta_final) * event.position.Normalized() + (1.0 + eccentricity * cos(theta_final)) * axis_z.Cross(event.position.Normalized()));
+	return true;
+}
+
 // 4. Equiareal isodetection rings
 std::vector<double> Isoreflection_Ring_Angles(unsigned int number_of_rings)
 {
@@ -213,4 +412,30 @@ std::vector<double> Isoreflection_Ring_Angles(unsigned int number_of_rings)
 	return thetas;
 }
 
-}	// namespace DaMaSCUS_SUN
\ No newline at end of file
+// 5. Counter-based random number streams
+std::array<std::uint32_t, 4> Philox_4x32(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key)
+{
+	for(int round = 0; round < 10; round++)
+	{
+		if(round > 0)
+		{
+			key[0] += 0x9E3779B9;
+			key[1] += 0xBB67AE85;
+		}
+		std::uint64_t product_0 = static_cast<std::uint64_t>(0xD2511F53) * counter[0];
+		std::uint64_t product_1 = static_cast<std::uint64_t>(0xCD9E8D57) * counter[2];
+		counter					= {{static_cast<std::uint32_t>(product_1 >> 32) ^ counter[1] ^ key[0], static_cast<std::uint32_t>(product_1), static_cast<std::uint32_t>(product_0 >> 32) ^ counter[3] ^ key[1], static_cast<std::uint32_t>(product_0)}};
+	}
+	return counter;
+}
+
+void Seed_PRNG_Stream(std::mt19937& PRNG, std::uint64_t global_seed, std::uint64_t stream, std::uint64_t trajectory)
+{
+	std::array<std::uint32_t, 4> counter = {{static_cast<std::uint32_t>(trajectory), static_cast<std::uint32_t>(trajectory >> 32), static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)}};
+	std::array<std::uint32_t, 2> key	 = {{static_cast<std::uint32_t>(global_seed), static_cast<std::uint32_t>(global_seed >> 32)}};
+	std::array<std::uint32_t, 4> bits	 = Philox_4x32(counter, key);
+	std::seed_seq seed_sequence(bits.begin(), bits.end());
+	PRNG.seed(seed_sequence);
+}
+
+}	// namespace DaMaSCUS_SUN
@@ -1,10 +1,20 @@
 #include "Solar_Model.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <mpi.h>
+#include <numeric>
+#include <sstream>
 
 #include "libphysica/Integration.hpp"
 #include "libphysica/Natural_Units.hpp"
+#include "libphysica/Special_Functions.hpp"
 #include "libphysica/Statistics.hpp"
 #include "libphysica/Utilities.hpp"
 
@@ -14,6 +24,10 @@ namespace DaMaSCUS_SUN
 {
 
 using namespace libphysica::natural_units;
+
+// Upper end of the speed grids of the rate tables and the target fractions. Faster particles abort the simulation anyway, see Trajectory_Simulator::v_max.
+const double rate_table_maximum_speed = 0.75;
+
 // 1. Nuclear targets in the Sun
 Solar_Isotope::Solar_Isotope(const obscura::Isotope& isotope, const std::vector<std::vector<double>>& density_table, double abundance)
 : Isotope(isotope), number_density(libphysica::Interpolation(density_table))
@@ -21,7 +35,7 @@ Solar_Isotope::Solar_Isotope(const obscura::Isotope& isotope, const std::vector<
 	number_density.Multiply(abundance);
 }
 
-double Solar_Isotope::Number_Density(double r)
+double Solar_Isotope::Number_Density(double r) const
 {
 	if(r > rSun)
 		return 0.0;
@@ -29,6 +43,14 @@ double Solar_Isotope::Number_Density(double r)
 		return number_density(r);
 }
 
+double Solar_Isotope::Number_Density_Derivative(double r) const
+{
+	if(r > rSun)
+		return 0.0;
+	else
+		return number_density(r, 1);
+}
+
 // 2. Solar model
 // Auxiliary functions for the data import
 void Solar_Model::Import_Raw_Data()
@@ -116,8 +138,45 @@ std::vector<std::vector<double>> Solar_Model::Create_Number_Density_Table_Electr
 	return table;
 }
 
+void Solar_Model::Tabulate_Radial_Profiles(unsigned int grid_intervals)
+{
+	radial_grid_intervals = grid_intervals;
+	radial_grid_spacing	  = rSun / grid_intervals;
+	profiles_per_node	  = 5 + target_isotopes.size();
+	radial_profiles		  = std::vector<double>((grid_intervals + 1) * 2 * profiles_per_node, 0.0);
+	for(unsigned int i = 0; i <= grid_intervals; i++)
+	{
+		double r	  = (i == grid_intervals) ? rSun : i * radial_grid_spacing;
+		double* node  = &radial_profiles[2 * i * profiles_per_node];
+		double* slope = node + profiles_per_node;
+		node[0]		  = mass(r);
+		node[1]		  = temperature(r);
+		node[2]		  = local_escape_speed_squared(r);
+		node[3]		  = mass_density(r);
+		node[4]		  = number_density_electron(r);
+		slope[0]	  = mass(r, 1);
+		slope[1]	  = temperature(r, 1);
+		slope[2]	  = local_escape_speed_squared(r, 1);
+		slope[3]	  = mass_density(r, 1);
+		slope[4]	  = number_density_electron(r, 1);
+		for(unsigned int j = 0; j < target_isotopes.size(); j++)
+		{
+			node[5 + j]	 = target_isotopes[j].Number_Density(r);
+			slope[5 + j] = target_isotopes[j].Number_Density_Derivative(r);
+		}
+		for(unsigned int j = 0; j < profiles_per_node; j++)
+			slope[j] *= radial_grid_spacing;
+	}
+}
+
+double Solar_Model::Tabulated_Profile(const Radial_Grid_Point& point, unsigned int profile) const
+{
+	const double* node = &radial_profiles[point.offset + profile];
+	return point.basis[0] * node[0] + point.basis[1] * node[profiles_per_node] + point.basis[2] * node[2 * profiles_per_node] + point.basis[3] * node[3 * profiles_per_node];
+}
+
 Solar_Model::Solar_Model()
-: using_interpolated_rate(false), name("Standard Solar Model AGSS09")
+: using_interpolated_rate(false), rate_scale_factor(1.0), rate_table_reference_rate(0.0), rate_table_accuracy(0.0), rate_table_build_time(0.0), mpi_communicator(MPI_COMM_WORLD), using_tabulated_targets(false), name("Standard Solar Model AGSS09")
 {
 	Import_Raw_Data();
 
@@ -151,9 +210,12 @@ Solar_Model::Solar_Model()
 	}
 	// Electron number density
 	number_density_electron = libphysica::Interpolation(Create_Number_Density_Table_Electron());
+
+	// The grid spacing of 0.0005 rSun coincides with the AGSS09 table. The interpolations above are cubic between the table's radii, so that the cubic Hermite interpolation of the grid reproduces them.
+	Tabulate_Radial_Profiles(2000);
 }
 
-double Solar_Model::Mass(double r)
+double Solar_Model::Mass(double r) const
 {
 	if(r > rSun)
 		return mSun;
@@ -161,7 +223,7 @@ double Solar_Model::Mass(double r)
 		return mass(r);
 }
 
-double Solar_Model::Mass_Density(double r)
+double Solar_Model::Mass_Density(double r) const
 {
 	if(r > rSun)
 		return 0.0;
@@ -169,12 +231,12 @@ double Solar_Model::Mass_Density(double r)
 		return mass_density(r);
 }
 
-double Solar_Model::Temperature(double r)
+double Solar_Model::Temperature(double r) const
 {
 	return temperature(r);
 }
 
-double Solar_Model::Local_Escape_Speed(double r)
+double Solar_Model::Local_Escape_Speed(double r) const
 {
 	if(r > rSun)
 		return sqrt(2 * G_Newton * mSun / r);
@@ -182,7 +244,7 @@ double Solar_Model::Local_Escape_Speed(double r)
 		return sqrt(local_escape_speed_squared(r));
 }
 
-double Solar_Model::Debye_Screening_Scale_Squared(double r)
+double Solar_Model::Debye_Screening_Scale_Squared(double r) const
 {
 	if(r <= rSun)
 	{
@@ -199,7 +261,7 @@ double Solar_Model::Debye_Screening_Scale_Squared(double r)
 	}
 }
 
-double Solar_Model::Number_Density_Nucleus(double r, unsigned int nucleus_index)
+double Solar_Model::Number_Density_Nucleus(double r, unsigned int nucleus_index) const
 {
 	if(nucleus_index >= target_isotopes.size())
 	{
@@ -210,7 +272,7 @@ double Solar_Model::Number_Density_Nucleus(double r, unsigned int nucleus_index)
 		return target_isotopes[nucleus_index].Number_Density(r);
 }
 
-double Solar_Model::Number_Density_Electron(double r)
+double Solar_Model::Number_Density_Electron(double r) const
 {
 	if(r > rSun)
 		return 0.0;
@@ -218,35 +280,143 @@ double Solar_Model::Number_Density_Electron(double r)
 		return number_density_electron(r);
 }
 
-double Solar_Model::DM_Scattering_Rate_Electron(obscura::DM_Particle& DM, double r, double DM_speed)
+double Solar_Model::DM_Scattering_Rate_Electron(obscura::DM_Particle& DM, double r, double DM_speed) const
 {
-	if(r > rSun)
+	return DM_Scattering_Rate_Electron(DM, Radial_Grid_Lookup(r), DM_speed);
+}
+
+double Solar_Model::DM_Scattering_Rate_Nucleus(obscura::DM_Particle& DM, double r, double DM_speed, unsigned int nucleus_index) const
+{
+	return DM_Scattering_Rate_Nucleus(DM, Radial_Grid_Lookup(r), DM_speed, nucleus_index);
+}
+
+Radial_Grid_Point Solar_Model::Radial_Grid_Lookup(double r) const
+{
+	double x		= r / radial_grid_spacing;
+	unsigned int i	= (x < radial_grid_intervals) ? x : radial_grid_intervals - 1;
+	double t		= std::min(x - i, 1.0);
+	Radial_Grid_Point point;
+	point.radius   = r;
+	point.offset   = 2 * i * profiles_per_node;
+	point.weight   = t;
+	point.basis[0] = (1.0 + 2.0 * t) * (1.0 - t) * (1.0 - t);
+	point.basis[1] = t * (1.0 - t) * (1.0 - t);
+	point.basis[2] = t * t * (3.0 - 2.0 * t);
+	point.basis[3] = t * t * (t - 1.0);
+	return point;
+}
+
+double Solar_Model::Mass(const Radial_Grid_Point& point) const
+{
+	if(point.radius > rSun)
+		return mSun;
+	else
+		return Tabulated_Profile(point, 0);
+}
+
+double Solar_Model::Mass_Density(const Radial_Grid_Point& point) const
+{
+	if(point.radius > rSun)
 		return 0.0;
 	else
+		return Tabulated_Profile(point, 3);
+}
+
+double Solar_Model::Temperature(const Radial_Grid_Point& point) const
+{
+	return Tabulated_Profile(point, 1);
+}
+
+double Solar_Model::Local_Escape_Speed(const Radial_Grid_Point& point) const
+{
+	if(point.radius > rSun)
+		return sqrt(2 * G_Newton * mSun / point.radius);
+	else
+		return sqrt(Tabulated_Profile(point, 2));
+}
+
+double Solar_Model::Number_Density_Nucleus(const Radial_Grid_Point& point, unsigned int nucleus_index) const
+{
+	if(nucleus_index >= target_isotopes.size())
 	{
-		double v_rel = Thermal_Averaged_Relative_Speed(Temperature(r), mElectron, DM_speed);
-		return Number_Density_Electron(r) * DM.Sigma_Total_Electron(DM_speed) * v_rel;
+		std::cerr << "Error in Solar_Model::Number_Density_Nucleus(): Index = " << nucleus_index << " is out of bound (number of targets: " << target_isotopes.size() << ")." << std::endl;
+		std::exit(EXIT_FAILURE);
 	}
+	else if(point.radius > rSun)
+		return 0.0;
+	else
+		return Tabulated_Profile(point, 5 + nucleus_index);
 }
 
-double Solar_Model::DM_Scattering_Rate_Nucleus(obscura::DM_Particle& DM, double r, double DM_speed, unsigned int nucleus_index)
+double Solar_Model::Number_Density_Electron(const Radial_Grid_Point& point) const
+{
+	if(point.radius > rSun)
+		return 0.0;
+	else
+		return Tabulated_Profile(point, 4);
+}
+
+double Solar_Model::Scale_Height(const Radial_Grid_Point& point) const
+{
+	// The derivatives of the cubic Hermite interpolation
+	double t			= point.weight;
+	double scale_height = rSun;
+	for(unsigned int profile : {1, 3})
+	{
+		const double* node = &radial_profiles[point.offset + profile];
+		double derivative  = (6.0 * t * (t - 1.0) * (node[0] - node[2 * profiles_per_node]) + (1.0 - t) * (1.0 - 3.0 * t) * node[profiles_per_node] + t * (3.0 * t - 2.0) * node[3 * profiles_per_node]) / radial_grid_spacing;
+		if(derivative != 0.0)
+			scale_height = std::min(scale_height, fabs(Tabulated_Profile(point, profile) / derivative));
+	}
+	return scale_height;
+}
+
+double Solar_Model::DM_Scattering_Rate_Electron(obscura::DM_Particle& DM, const Radial_Grid_Point& point, double DM_speed) const
+{
+	if(point.radius > rSun)
+		return 0.0;
+	else
+	{
+		double v_rel = Thermal_Averaged_Relative_Speed(Temperature(point), mElectron, DM_speed);
+		return Number_Density_Electron(point) * DM.Sigma_Total_Electron(DM_speed) * v_rel;
+	}
+}
+
+double Solar_Model::DM_Scattering_Rate_Nucleus(obscura::DM_Particle& DM, const Radial_Grid_Point& point, double DM_speed, unsigned int nucleus_index) const
 {
 	if(nucleus_index >= target_isotopes.size())
 	{
-		std::cerr << "Error in Solar_Model::Number_Density_Nucleus(): Index = " << nucleus_index << " is out of bound (number of targets: " << target_isotopes.size() << ")." << std::endl;
+		std::cerr << "Error in Solar_Model::DM_Scattering_Rate_Nucleus(): Index = " << nucleus_index << " is out of bound (number of targets: " << target_isotopes.size() << ")." << std::endl;
 		std::exit(EXIT_FAILURE);
 	}
-	else if(r > rSun)
+	else if(point.radius > rSun)
 		return 0.0;
 	else
 	{
 		double m_target = target_isotopes[nucleus_index].mass;
-		double v_rel	= Thermal_Averaged_Relative_Speed(Temperature(r), m_target, DM_speed);
-		return Number_Density_Nucleus(r, nucleus_index) * DM.Sigma_Total_Nucleus(target_isotopes[nucleus_index], DM_speed, r) * v_rel;
+		double v_rel	= Thermal_Averaged_Relative_Speed(Temperature(point), m_target, DM_speed);
+		return Number_Density_Nucleus(point, nucleus_index) * DM.Sigma_Total_Nucleus(target_isotopes[nucleus_index], DM_speed, point.radius) * v_rel;
+	}
+}
+
+void Solar_Model::DM_Scattering_Rates(obscura::DM_Particle& DM, const Radial_Grid_Point& point, double DM_speed, std::vector<double>& rates) const
+{
+	rates.resize(1 + target_isotopes.size());
+	if(point.radius > rSun)
+		std::fill(rates.begin(), rates.end(), 0.0);
+	else
+	{
+		// The temperature and the grid node are shared by all targets.
+		double T = Temperature(point);
+		rates[0] = Tabulated_Profile(point, 4) * DM.Sigma_Total_Electron(DM_speed) * Thermal_Averaged_Relative_Speed(T, mElectron, DM_speed);
+		for(unsigned int i = 0; i < target_isotopes.size(); i++)
+			rates[1 + i] = DM.Sigma_Total_Nucleus(target_isotopes[i], DM_speed, point.radius);
+		for(unsigned int i = 0; i < target_isotopes.size(); i++)
+			rates[1 + i] *= Tabulated_Profile(point, 5 + i) * Thermal_Averaged_Relative_Speed(T, target_isotopes[i].mass, DM_speed);
 	}
 }
 
-double Solar_Model::Total_DM_Scattering_Rate(obscura::DM_Particle& DM, double r, double DM_speed)
+double Solar_Model::Total_DM_Scattering_Rate(obscura::DM_Particle& DM, double r, double DM_speed) const
 {
 	if(using_interpolated_rate && DM_speed < rate_interpolation.domain[1][1])
 		return Total_DM_Scattering_Rate_Interpolated(DM, r, DM_speed);
@@ -258,64 +428,440 @@ double Solar_Model::Total_DM_Scattering_Rate(obscura::DM_Particle& DM, double r,
 	}
 }
 
-double Solar_Model::Total_DM_Scattering_Rate_Computed(obscura::DM_Particle& DM, double r, double DM_speed)
+double Solar_Model::Total_DM_Scattering_Rate_Computed(obscura::DM_Particle& DM, double r, double DM_speed) const
 {
 	if(r > rSun)
 		return 0.0;
 	else
 	{
-		double total_rate = DM_Scattering_Rate_Electron(DM, r, DM_speed);
+		Radial_Grid_Point point = Radial_Grid_Lookup(r);
+		double total_rate		= DM_Scattering_Rate_Electron(DM, point, DM_speed);
 		for(unsigned int i = 0; i < target_isotopes.size(); i++)
-			total_rate += DM_Scattering_Rate_Nucleus(DM, r, DM_speed, i);
+			total_rate += DM_Scattering_Rate_Nucleus(DM, point, DM_speed, i);
 		return total_rate;
 	}
 }
 
-double Solar_Model::Total_DM_Scattering_Rate_Interpolated(obscura::DM_Particle& DM, double r, double DM_speed)
+double Solar_Model::Total_DM_Scattering_Rate_Interpolated(obscura::DM_Particle& DM, double r, double DM_speed) const
 {
 	if(r > rSun)
 		return 0.0;
 	else
-		return rate_interpolation(r, DM_speed);
+		return rate_scale_factor * rate_interpolation(r, DM_speed);
 }
 
 void Solar_Model::Interpolate_Total_DM_Scattering_Rate(obscura::DM_Particle& DM, unsigned int N_radius, unsigned int N_speed)
 {
 	if(N_radius == 0 || N_speed == 0)
+	{
 		using_interpolated_rate = false;
+		using_tabulated_targets = false;
+	}
+	// If only the coupling changed, the reference table gets rescaled, and the target fractions stay the same.
+	else if(using_interpolated_rate && rate_table_accuracy == 0.0 && N_radius == rate_table_N_radius && N_speed == rate_table_N_speed && Rescale_Total_DM_Scattering_Rate(DM))
+		return;
 	else
 	{
-		int mpi_processes, mpi_rank;
-		MPI_Comm_size(MPI_COMM_WORLD, &mpi_processes);
-		MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+		auto time_start = std::chrono::system_clock::now();
+		int mpi_processes;
+		MPI_Comm_size(mpi_communicator, &mpi_processes);
+
+		// The radial grid gets rounded up to a multiple of the number of MPI processes.
+		unsigned int global_N_radius = mpi_processes * std::ceil(1.0 * N_radius / mpi_processes);
+		Build_Rate_Table(DM, libphysica::Linear_Space(0, rSun, global_N_radius), libphysica::Linear_Space(0, rate_table_maximum_speed, N_speed), 0.0);
+
+		rate_table_N_radius	  = N_radius;
+		rate_table_N_speed	  = N_speed;
+		rate_table_accuracy	  = 0.0;
+		rate_table_build_time = 1e-6 * std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - time_start).count();
+	}
+}
+
+void Solar_Model::Interpolate_Total_DM_Scattering_Rate_Adaptive(obscura::DM_Particle& DM, double relative_accuracy, unsigned int max_nodes)
+{
+	if(relative_accuracy <= 0.0 || max_nodes < 18)
+	{
+		std::cerr << "Error in Solar_Model::Interpolate_Total_DM_Scattering_Rate_Adaptive(): The accuracy must be positive and the grid needs at least 18 nodes per dimension." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	else if(using_interpolated_rate && rate_table_accuracy == relative_accuracy && max_nodes == rate_table_N_radius && max_nodes == rate_table_N_speed && Rescale_Total_DM_Scattering_Rate(DM))
+		return;
+	auto time_start = std::chrono::system_clock::now();
+
+	// The radial grid starts uniform and gets refined towards the core and the photosphere, the speed grid starts logarithmic to resolve slow particles.
+	std::vector<double> radii  = Refine_Rate_Grid(DM, libphysica::Linear_Space(0, rSun, 17), true, {1.0e-4, 1.0e-3, 1.0e-2, 0.1}, relative_accuracy, max_nodes);
+	std::vector<double> speeds = libphysica::Log_Space(1.0e-5, rate_table_maximum_speed, 16);
+	speeds.insert(speeds.begin(), 0.0);
+	speeds = Refine_Rate_Grid(DM, speeds, false, {0.0, 0.3 * rSun, 0.6 * rSun, 0.9 * rSun}, relative_accuracy, max_nodes);
+	Build_Rate_Table(DM, radii, speeds, relative_accuracy);
+
+	rate_table_N_radius	  = max_nodes;
+	rate_table_N_speed	  = max_nodes;
+	rate_table_accuracy	  = relative_accuracy;
+	rate_table_build_time = 1e-6 * std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - time_start).count();
+}
 
-		using_interpolated_rate = true;
+double Solar_Model::Rate_Table_Memory() const
+{
+	if(!using_interpolated_rate)
+		return 0.0;
+	double nodes = rate_table_radii.size() * rate_table_speeds.size() + rate_table_radii.size() + rate_table_speeds.size();
+	return nodes * sizeof(double);
+}
 
-		double vMax					 = 0.75;
-		unsigned int local_N_radius	 = std::ceil(1.0 * N_radius / mpi_processes);
-		unsigned int global_N_radius = mpi_processes * local_N_radius;
+double Solar_Model::Rate_Table_Build_Time() const
+{
+	return using_interpolated_rate ? rate_table_build_time : 0.0;
+}
 
-		std::vector<double> global_radii = libphysica::Linear_Space(0, rSun, global_N_radius);
-		std::vector<double> local_radii(local_N_radius, 0.0);
+std::vector<unsigned int> Solar_Model::Rate_Table_Grid() const
+{
+	if(!using_interpolated_rate)
+		return {0, 0};
+	return {(unsigned int) rate_table_radii.size(), (unsigned int) rate_table_speeds.size()};
+}
+
+void Solar_Model::Print_Rate_Table_Summary(int mpi_rank) const
+{
+	if(mpi_rank == 0 && using_interpolated_rate)
+		std::cout << "Sc. rate table:\t" << rate_table_radii.size() << "×" << rate_table_speeds.size() << ((rate_table_accuracy > 0.0) ? " (adaptive, rel. accuracy " + std::to_string(libphysica::Round(rate_table_accuracy)) + ")" : " (uniform)") << std::endl
+				  << "\tMemory [kB]:\t" << libphysica::Round(Rate_Table_Memory() / 1024.0) << std::endl
+				  << "\tBuild time [s]:\t" << libphysica::Round(rate_table_build_time) << std::endl
+				  << std::endl;
+}
+
+bool Solar_Model::Rescale_Total_DM_Scattering_Rate(obscura::DM_Particle& DM)
+{
+	if(!using_interpolated_rate || DM.mass != rate_table_DM_mass || rate_table_reference_rate <= 0.0)
+		return false;
+	// The rates at all probe points must have changed by the same factor.
+	std::vector<double> probes = Rate_Probes(DM);
+	double scale_factor		   = probes[0] / rate_table_probes[0];
+	if(!(scale_factor > 0.0))
+		return false;
+	for(unsigned int i = 1; i < probes.size(); i++)
+		if(std::fabs(probes[i] - scale_factor * rate_table_probes[i]) > 1.0e-9 * probes[i])
+			return false;
+	rate_scale_factor *= scale_factor;
+	rate_table_probes = probes;
+	return true;
+}
+
+std::vector<double> Solar_Model::Refine_Rate_Grid(obscura::DM_Particle& DM, std::vector<double> grid, bool radial_grid, const std::vector<double>& fixed_coordinates, double relative_accuracy, unsigned int max_nodes) const
+{
+	auto rates_at = [&](double x) {
+		std::vector<double> rates;
+		for(auto& y : fixed_coordinates)
+			rates.push_back(radial_grid ? Total_DM_Scattering_Rate_Computed(DM, x, y) : Total_DM_Scattering_Rate_Computed(DM, y, x));
+		return rates;
+	};
+	std::vector<std::vector<double>> rates;
+	for(auto& x : grid)
+		rates.push_back(rates_at(x));
+
+	// Errors are relative to the local rate, but with a floor, such that the vanishing rates at the surface do not get resolved indefinitely.
+	std::vector<double> rate_floor(fixed_coordinates.size(), 0.0);
+	for(auto& node_rates : rates)
+		for(unsigned int j = 0; j < fixed_coordinates.size(); j++)
+			rate_floor[j] = std::max(rate_floor[j], 1.0e-6 * node_rates[j]);
+	double minimum_width = 1.0e-6 * (grid.back() - grid.front());
+
+	// Bisect every interval whose midpoint deviates from the linear interpolation, until all intervals pass or the node budget is spent.
+	std::vector<bool> converged(grid.size() - 1, false);
+	bool refined = true;
+	while(refined && grid.size() < max_nodes)
+	{
+		refined									   = false;
+		std::vector<double> new_grid			   = {grid[0]};
+		std::vector<std::vector<double>> new_rates = {rates[0]};
+		std::vector<bool> new_converged;
+		for(unsigned int i = 0; i < converged.size(); i++)
+		{
+			unsigned int nodes = grid.size() + new_grid.size() - i - 1;
+			if(!converged[i] && nodes < max_nodes && grid[i + 1] - grid[i] > 2.0 * minimum_width)
+			{
+				double x_mid				  = (grid[i] + grid[i + 1]) / 2.0;
+				std::vector<double> rates_mid = rates_at(x_mid);
+				bool accurate				  = true;
+				for(unsigned int j = 0; j < fixed_coordinates.size(); j++)
+					if(std::fabs(rates_mid[j] - (rates[i][j] + rates[i + 1][j]) / 2.0) > relative_accuracy * std::max(rates_mid[j], rate_floor[j]))
+						accurate = false;
+				if(!accurate)
+				{
+					new_grid.push_back(x_mid);
+					new_rates.push_back(rates_mid);
+					new_converged.push_back(false);
+					refined = true;
+				}
+				new_converged.push_back(accurate);
+			}
+			else
+				new_converged.push_back(converged[i] || grid[i + 1] - grid[i] <= 2.0 * minimum_width);
+			new_grid.push_back(grid[i + 1]);
+			new_rates.push_back(rates[i + 1]);
+		}
+		grid	  = new_grid;
+		rates	  = new_rates;
+		converged = new_converged;
+	}
+	return grid;
+}
 
-		// Compute the table in parallel
-		MPI_Scatter(global_radii.data(), local_N_radius, MPI_DOUBLE, local_radii.data(), local_N_radius, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		std::vector<double> speeds = libphysica::Linear_Space(0, vMax, N_speed);
+void Solar_Model::Build_Rate_Table(obscura::DM_Particle& DM, const std::vector<double>& radii, const std::vector<double>& speeds, double relative_accuracy)
+{
+	int mpi_processes, mpi_rank;
+	MPI_Comm_size(mpi_communicator, &mpi_processes);
+	MPI_Comm_rank(mpi_communicator, &mpi_rank);
+
+	using_interpolated_rate = true;
+
+	// Look up the table in the cache, where process 0 decides for all processes.
+	std::vector<double> probes = Rate_Probes(DM);
+	std::string cache_file	   = Rate_Table_Cache_File(DM.mass, probes, radii.size(), speeds.size(), relative_accuracy);
+	int cached				   = 0;
+	if(!cache_file.empty() && mpi_rank == 0)
+		cached = std::ifstream(cache_file).good();
+	MPI_Bcast(&cached, 1, MPI_INT, 0, mpi_communicator);
+
+	std::vector<std::vector<double>> rates;
+	if(cached)
+		rates = Import_Rate_Table(cache_file, rate_table_reference_rate);
+	else
+	{
+		// Compute the table in parallel, each process takes a block of radii, padded to equal size.
+		unsigned int N_radius		= radii.size();
+		unsigned int N_speed		= speeds.size();
+		unsigned int local_N_radius	= std::ceil(1.0 * N_radius / mpi_processes);
 		std::vector<double> local_rates;
-		std::vector<double> global_rates(N_speed * global_N_radius, 0.0);
-		for(auto& radius : local_radii)
+		std::vector<double> global_rates(N_speed * local_N_radius * mpi_processes, 0.0);
+		for(unsigned int i = mpi_rank * local_N_radius; i < (mpi_rank + 1) * local_N_radius; i++)
 			for(auto& speed : speeds)
-				local_rates.push_back(Total_DM_Scattering_Rate_Computed(DM, radius, speed));
-		MPI_Allgather(local_rates.data(), local_N_radius * N_speed, MPI_DOUBLE, global_rates.data(), local_N_radius * N_speed, MPI_DOUBLE, MPI_COMM_WORLD);
+				local_rates.push_back((i < N_radius) ? Total_DM_Scattering_Rate_Computed(DM, radii[i], speed) : 0.0);
+		MPI_Allgather(local_rates.data(), local_N_radius * N_speed, MPI_DOUBLE, global_rates.data(), local_N_radius * N_speed, MPI_DOUBLE, mpi_communicator);
 
-		// Re-organize into a 2D array and interpolate.
-		std::vector<std::vector<double>> rates;
+		// Re-organize into a 2D array.
 		int i = 0;
-		for(auto& radius : global_radii)
+		for(auto& radius : radii)
 			for(auto& speed : speeds)
 				rates.push_back({radius, speed, global_rates[i++]});
-		rate_interpolation = libphysica::Interpolation_2D(rates);
+		rate_table_reference_rate = probes[0];
+
+		// The target fractions vary slowly and are tabulated on a coarser grid.
+		Tabulate_Target_Fractions(DM, std::min<unsigned int>(radii.size(), 100), std::min<unsigned int>(speeds.size(), 100));
+
+		if(!cache_file.empty())
+		{
+			if(mpi_rank == 0)
+				Export_Rate_Table(cache_file, rates, rate_table_reference_rate);
+			MPI_Barrier(mpi_communicator);
+		}
+	}
+	rate_interpolation = libphysica::Interpolation_2D(rates);
+
+	// The table is the reference for later changes of the coupling.
+	rate_table_radii   = radii;
+	rate_table_speeds  = speeds;
+	rate_table_DM_mass = DM.mass;
+	rate_table_probes  = probes;
+	rate_scale_factor  = (rate_table_reference_rate > 0.0) ? probes[0] / rate_table_reference_rate : 1.0;
+}
+
+void Solar_Model::Set_MPI_Communicator(MPI_Comm communicator)
+{
+	mpi_communicator = communicator;
+}
+
+void Solar_Model::Use_Rate_Table_Cache(const std::string& directory)
+{
+	rate_table_cache_directory = directory;
+}
+
+std::vector<double> Solar_Model::Rate_Probes(obscura::DM_Particle& DM) const
+{
+	std::vector<double> probes;
+	for(double radius : {0.1 * rSun, 0.5 * rSun, 0.9 * rSun})
+		for(double speed : {1.0e-3, 1.0e-2})
+			probes.push_back(Total_DM_Scattering_Rate_Computed(DM, radius, speed));
+	return probes;
+}
+
+std::string Solar_Model::Rate_Table_Cache_File(obscura::DM_Particle& DM, unsigned int N_radius, unsigned int N_speed, double relative_accuracy) const
+{
+	if(rate_table_cache_directory.empty())
+		return "";
+	return Rate_Table_Cache_File(DM.mass, Rate_Probes(DM), N_radius, N_speed, relative_accuracy);
+}
+
+std::string Solar_Model::Rate_Table_Cache_File(double DM_mass, const std::vector<double>& probes, unsigned int N_radius, unsigned int N_speed, double relative_accuracy) const
+{
+	if(rate_table_cache_directory.empty() || probes[0] <= 0.0)
+		return "";
+
+	// The key contains the relative rates at the probe points, which identify the interaction and form factor, but not the coupling.
+	// They are rounded to 9 digits, since rescaled couplings can change the last bits.
+	std::ostringstream key;
+	key << name << "|" << PROJECT_VERSION << "|" << std::scientific << std::setprecision(9) << DM_mass << "|" << N_radius << "|" << N_speed;
+	for(auto& probe : probes)
+		key << "|" << probe / probes[0];
+	if(relative_accuracy > 0.0)
+		key << "|adaptive|" << relative_accuracy;
+
+	// 64-bit FNV-1a hash
+	std::uint64_t hash = 14695981039346656037ULL;
+	for(char c : key.str())
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ULL;
+	}
+	std::ostringstream filename;
+	filename << rate_table_cache_directory << "rate_table_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+	return filename.str();
+}
+
+// 1. Signature 2. Number of rows 3. Rate at the first probe point, relative to which the table gets rescaled 4. Rows (r, v, rate)
+// 5. Radii, speeds, and targets of the target fraction table 6. Target fractions
+const char rate_table_signature[8] = {'D', 'M', 'S', 'C', 'R', 'A', 'T', '2'};
+
+std::vector<std::vector<double>> Solar_Model::Import_Rate_Table(const std::string& filename, double& table_reference_rate)
+{
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	char signature[sizeof(rate_table_signature)];
+	std::uint64_t rows = 0;
+	file.read(signature, sizeof(signature));
+	file.read(reinterpret_cast<char*>(&rows), sizeof(rows));
+	file.read(reinterpret_cast<char*>(&table_reference_rate), sizeof(table_reference_rate));
+	std::vector<double> entries(3 * rows);
+	file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(double));
+	std::uint64_t target_table[3] = {0, 0, 0};
+	file.read(reinterpret_cast<char*>(target_table), sizeof(target_table));
+	if(file && target_table[2] == target_isotopes.size() + 1)
+	{
+		target_fractions = std::vector<double>(target_table[0] * target_table[1] * target_table[2]);
+		file.read(reinterpret_cast<char*>(target_fractions.data()), target_fractions.size() * sizeof(double));
+	}
+	if(!file || std::memcmp(signature, rate_table_signature, sizeof(signature)) != 0 || table_reference_rate <= 0.0 || target_table[0] < 2 || target_table[1] < 2 || target_table[2] != target_isotopes.size() + 1)
+	{
+		std::cerr << "Error in Solar_Model::Import_Rate_Table(): File " << filename << " is not a valid rate table and should be deleted." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	std::vector<std::vector<double>> rates;
+	for(unsigned int i = 0; i < rows; i++)
+		rates.push_back({entries[3 * i], entries[3 * i + 1], entries[3 * i + 2]});
+
+	target_table_radii		 = target_table[0];
+	target_table_speeds		 = target_table[1];
+	target_table_radius_step = rSun / (target_table_radii - 1);
+	target_table_speed_step	 = rate_table_maximum_speed / (target_table_speeds - 1);
+	using_tabulated_targets	 = true;
+	return rates;
+}
+
+void Solar_Model::Export_Rate_Table(const std::string& filename, const std::vector<std::vector<double>>& rates, double reference_rate) const
+{
+	// Several groups of processes can compute the same table at the same time, so the table is written to a temporary file, which gets renamed atomically.
+	int mpi_world_rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &mpi_world_rank);
+	std::string temporary_filename = filename + "." + std::to_string(mpi_world_rank) + ".tmp";
+	std::ofstream file(temporary_filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!file)
+	{
+		std::cerr << "Warning in Solar_Model::Export_Rate_Table(): File " << filename << " could not be opened, the rate table is not cached." << std::endl;
+		return;
+	}
+	std::uint64_t rows = rates.size();
+	file.write(rate_table_signature, sizeof(rate_table_signature));
+	file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+	file.write(reinterpret_cast<const char*>(&reference_rate), sizeof(reference_rate));
+	for(auto& row : rates)
+		file.write(reinterpret_cast<const char*>(row.data()), 3 * sizeof(double));
+	std::uint64_t target_table[3] = {target_table_radii, target_table_speeds, target_isotopes.size() + 1};
+	file.write(reinterpret_cast<const char*>(target_table), sizeof(target_table));
+	file.write(reinterpret_cast<const char*>(target_fractions.data()), target_fractions.size() * sizeof(double));
+	file.close();
+	if(!file || std::rename(temporary_filename.c_str(), filename.c_str()) != 0)
+	{
+		std::cerr << "Warning in Solar_Model::Export_Rate_Table(): File " << filename << " could not be written, the rate table is not cached." << std::endl;
+		std::remove(temporary_filename.c_str());
+	}
+}
+
+void Solar_Model::Tabulate_Target_Fractions(obscura::DM_Particle& DM, unsigned int N_radius, unsigned int N_speed)
+{
+	if(N_radius < 2 || N_speed < 2)
+	{
+		std::cerr << "Error in Solar_Model::Tabulate_Target_Fractions(): The grid needs at least 2x2 points." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	unsigned int targets	 = target_isotopes.size() + 1;
+	target_table_radii		 = N_radius;
+	target_table_speeds		 = N_speed;
+	target_table_radius_step = rSun / (N_radius - 1);
+	target_table_speed_step	 = rate_table_maximum_speed / (N_speed - 1);
+
+	// Compute the table in parallel, each process takes a block of radii, padded to equal size.
+	int mpi_processes, mpi_rank;
+	MPI_Comm_size(mpi_communicator, &mpi_processes);
+	MPI_Comm_rank(mpi_communicator, &mpi_rank);
+	unsigned int local_N_radius = std::ceil(1.0 * N_radius / mpi_processes);
+	unsigned int local_nodes	= local_N_radius * N_speed * targets;
+	std::vector<double> local_fractions(local_nodes, 0.0);
+	std::vector<double> global_fractions(local_nodes * mpi_processes, 0.0);
+	std::vector<double> rates;
+	for(unsigned int i = mpi_rank * local_N_radius; i < std::min((mpi_rank + 1) * local_N_radius, N_radius); i++)
+	{
+		Radial_Grid_Point point = Radial_Grid_Lookup(std::min(i * target_table_radius_step, rSun));
+		for(unsigned int j = 0; j < N_speed; j++)
+		{
+			DM_Scattering_Rates(DM, point, j * target_table_speed_step, rates);
+			std::partial_sum(rates.begin(), rates.end(), rates.begin());
+			double* node = &local_fractions[((i - mpi_rank * local_N_radius) * N_speed + j) * targets];
+			for(unsigned int k = 0; k < targets; k++)
+				node[k] = (rates.back() > 0.0) ? rates[k] / rates.back() : 1.0;
+			node[targets - 1] = 1.0;
+		}
+	}
+	MPI_Allgather(local_fractions.data(), local_nodes, MPI_DOUBLE, global_fractions.data(), local_nodes, MPI_DOUBLE, mpi_communicator);
+
+	// The blocks are ordered by radius, such that dropping the padding leaves the complete table.
+	global_fractions.resize(N_radius * N_speed * targets);
+	target_fractions		= global_fractions;
+	using_tabulated_targets = true;
+}
+
+bool Solar_Model::Target_Fractions_Tabulated(double DM_speed) const
+{
+	return using_tabulated_targets && DM_speed <= (target_table_speeds - 1) * target_table_speed_step;
+}
+
+int Solar_Model::Sample_Target_Tabulated(double r, double DM_speed, double xi) const
+{
+	// Bilinear interpolation of the cumulative fractions between the four surrounding grid nodes
+	double x			 = r / target_table_radius_step;
+	double y			 = DM_speed / target_table_speed_step;
+	unsigned int i		 = std::min(static_cast<unsigned int>(x), target_table_radii - 2);
+	unsigned int j		 = std::min(static_cast<unsigned int>(y), target_table_speeds - 2);
+	double wr			 = std::min(x - i, 1.0);
+	double wv			 = std::min(y - j, 1.0);
+	unsigned int targets = target_isotopes.size() + 1;
+	const double* f00	 = &target_fractions[(i * target_table_speeds + j) * targets];
+	const double* f01	 = f00 + targets;
+	const double* f10	 = f00 + target_table_speeds * targets;
+	const double* f11	 = f10 + targets;
+	auto fraction		 = [=](unsigned int k) {
+		return (1.0 - wr) * ((1.0 - wv) * f00[k] + wv * f01[k]) + wr * ((1.0 - wv) * f10[k] + wv * f11[k]);
+	};
+
+	// Binary search for the first target whose cumulative fraction exceeds xi
+	unsigned int low = 0, high = targets - 1;
+	while(low < high)
+	{
+		unsigned int mid = (low + high) / 2;
+		if(fraction(mid) > xi)
+			high = mid;
+		else
+			low = mid + 1;
 	}
+	return static_cast<int>(low) - 1;
 }
 
 void Solar_Model::Print_Summary(int mpi_rank) const
@@ -0,0 +1,99 @@
+#include "Trajectory_Output.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "libphysica/Natural_Units.hpp"
+
+namespace DaMaSCUS_SUN
+{
+
+using namespace libphysica::natural_units;
+
+// 1. Fixed binary layout, identified by the file header
+const char file_signature[8]		  = {'D', 'M', 'S', 'C', 'T', 'R', 'J', '1'};
+const std::uint32_t record_size_bytes = sizeof(Trajectory_Record);
+
+// 2. Buffered binary sink shared by all simulators of one MPI process.
+Trajectory_Writer::Trajectory_Writer(const std::string& filename, unsigned int buffered_records)
+: buffer_size(buffered_records), number_of_trajectories(0)
+{
+	file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!file)
+	{
+		std::cerr << "Error in Trajectory_Writer::Trajectory_Writer(): File " << filename << " could not be opened." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	file.write(file_signature, sizeof(file_signature));
+	file.write(reinterpret_cast<const char*>(&record_size_bytes), sizeof(record_size_bytes));
+	buffer.reserve(buffer_size);
+}
+
+Trajectory_Writer::~Trajectory_Writer()
+{
+	Flush();
+}
+
+void Trajectory_Writer::Flush_Buffer()
+{
+	file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(Trajectory_Record));
+	buffer.clear();
+}
+
+std::uint64_t Trajectory_Writer::Write_Trajectory(std::vector<Trajectory_Record>& records)
+{
+	std::lock_guard<std::mutex> lock(file_mutex);
+	std::uint64_t index = number_of_trajectories++;
+	for(auto& record : records)
+	{
+		record.trajectory = index;
+		buffer.push_back(record);
+		if(buffer.size() >= buffer_size)
+			Flush_Buffer();
+	}
+	return index;
+}
+
+void Trajectory_Writer::Flush()
+{
+	std::lock_guard<std::mutex> lock(file_mutex);
+	Flush_Buffer();
+	file.flush();
+}
+
+// 3. Reading the binary files
+std::vector<Trajectory_Record> Import_Trajectory_Records(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	char signature[sizeof(file_signature)];
+	std::uint32_t record_size = 0;
+	file.read(signature, sizeof(signature));
+	file.read(reinterpret_cast<char*>(&record_size), sizeof(record_size));
+	if(!file || std::memcmp(signature, file_signature, sizeof(file_signature)) != 0 || record_size != record_size_bytes)
+	{
+		std::cerr << "Error in Import_Trajectory_Records(): File " << filename << " is not a trajectory file of this version." << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+	std::vector<Trajectory_Record> records;
+	Trajectory_Record record;
+	// A trailing incomplete record of an aborted run is ignored.
+	while(file.read(reinterpret_cast<char*>(&record), sizeof(record)))
+		records.push_back(record);
+	return records;
+}
+
+void Convert_Trajectories_To_Text(const std::string& binary_filename, const std::string& text_filename)
+{
+	std::vector<Trajectory_Record> records = Import_Trajectory_Records(binary_filename);
+	std::ofstream f(text_filename);
+	f << "# Trajectory\tt[s]\tx[km]\ty[km]\tz[km]\tvx[km/s]\tvy[km/s]\tvz[km/s]\tE[eV]\n";
+	for(auto& record : records)
+	{
+		f << record.trajectory << "\t" << In_Units(record.time, sec) << "\t"
+		  << In_Units(record.position[0], km) << "\t" << In_Units(record.position[1], km) << "\t" << In_Units(record.position[2], km) << "\t"
+		  << In_Units(record.velocity[0], km / sec) << "\t" << In_Units(record.velocity[1], km / sec) << "\t" << In_Units(record.velocity[2], km / sec) << "\t" << In_Units(record.energy, eV) << "\n";
+	}
+}
+
+}	// namespace DaMaSCUS_SUN
@@ -19,7 +19,9 @@ using namespace libphysica::natural_units;
 
 int main(int argc, char* argv[])
 {
-	MPI_Init(NULL, NULL);
+	// Only the main thread of each MPI process communicates.
+	int mpi_thread_support;
+	MPI_Init_thread(NULL, NULL, MPI_THREAD_FUNNELED, &mpi_thread_support);
 	int mpi_processes, mpi_rank;
 	MPI_Comm_size(MPI_COMM_WORLD, &mpi_processes);
 	MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
@@ -41,6 +43,8 @@ int main(int argc, char* argv[])
 	Configuration cfg(argv[1], mpi_rank);
 	Solar_Model SSM;
 	cfg.Print_Summary(mpi_rank);
+	if(cfg.threads_per_process > 1 && mpi_thread_support < MPI_THREAD_FUNNELED && mpi_rank == 0)
+		std::cerr << "Warning in main(): The MPI implementation does not support MPI_THREAD_FUNNELED." << std::endl;
 	MPI_Barrier(MPI_COMM_WORLD);
 	////////////////////////////////////////////////////////////////////////
 
@@ -51,6 +55,7 @@ int main(int argc, char* argv[])
 		double u_min = cfg.DM_detector->Minimum_DM_Speed(*cfg.DM);
 		Simulation_Data data_set(cfg.sample_size, u_min, cfg.isoreflection_rings);
 		data_set.Configure(1.1 * rSun, 1, 1000);
+		Configure_Simulation_Data(data_set, cfg, cfg.results_path + "Reflection_Data.bin");
 		if(mpi_rank == 0)
 			std::cout << "Generate data..." << std::endl
 					  << "\tm_DM [MeV]:\t" << libphysica::Round(In_Units(cfg.DM->mass, MeV)) << "\t\t"
@@ -58,12 +63,17 @@ int main(int argc, char* argv[])
 					  << "\tu_min [km/sec]:\t" << libphysica::Round(In_Units(u_min, km / sec)) << "\t\t"
 					  << "sigma_e [cm2]:\t" << libphysica::Round(In_Units(cfg.DM->Get_Interaction_Parameter("Electrons"), cm * cm)) << std::endl
 					  << std::endl;
-		SSM.Interpolate_Total_DM_Scattering_Rate(*cfg.DM, cfg.interpolation_points, cfg.interpolation_points);
+		if(cfg.interpolation_points > 0 && cfg.interpolation_accuracy > 0.0)
+			SSM.Interpolate_Total_DM_Scattering_Rate_Adaptive(*cfg.DM, cfg.interpolation_accuracy, cfg.interpolation_points);
+		else
+			SSM.Interpolate_Total_DM_Scattering_Rate(*cfg.DM, cfg.interpolation_points, cfg.interpolation_points);
+		SSM.Print_Rate_Table_Summary(mpi_rank);
 		data_set.Generate_Data(*cfg.DM, SSM, *cfg.DM_distr);
 		data_set.Print_Summary(mpi_rank);
-		if(cfg.isoreflection_rings == 1)
+		// Only the processes holding the complete data set compute the spectra.
+		if(cfg.isoreflection_rings == 1 && data_set.Data_Available())
 		{
-			Reflection_Spectrum spectrum(data_set, SSM, *cfg.DM_distr, cfg.DM->mass, 0);
+			Reflection_Spectrum spectrum(data_set, SSM, *cfg.DM_distr, cfg.DM->mass, 0, cfg.binned_KDE);
 			spectrum.Print_Summary(mpi_rank);
 
 			// Export differential DM flux dPhi/dv to file
@@ -88,7 +98,7 @@ int main(int argc, char* argv[])
 			libphysica::Print_Box("p = " + std::to_string(libphysica::Round(p)), 1, mpi_rank);
                         */
 		}
-		else
+		else if(data_set.Data_Available())
 		{
 			std::ofstream f;
 			f.open(cfg.results_path + "/Detection_Rate.txt");
@@ -98,7 +108,7 @@ int main(int argc, char* argv[])
 
 			for(unsigned int ring = 0; ring < cfg.isoreflection_rings; ring++)
 			{
-				Reflection_Spectrum spectrum(data_set, SSM, *cfg.DM_distr, cfg.DM->mass, ring);
+				Reflection_Spectrum spectrum(data_set, SSM, *cfg.DM_distr, cfg.DM->mass, ring, cfg.binned_KDE);
 				std::function<double(double)> func = [&spectrum, &cfg](double v) {
 					return spectrum.Differential_DM_Flux(v, cfg.DM->mass);
 				};
@@ -0,0 +1,21 @@
+#include <iostream>
+#include <string>
+
+#include "Trajectory_Output.hpp"
+
+using namespace DaMaSCUS_SUN;
+
+// Converts the binary trajectory file of one MPI process into a text file.
+int main(int argc, char* argv[])
+{
+	if(argc < 2 || argc > 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <trajectories.bin> [trajectories.txt]" << std::endl;
+		return 1;
+	}
+	std::string binary_filename = argv[1];
+	std::string text_filename	= (argc == 3) ? argv[2] : binary_filename.substr(0, binary_filename.find_last_of('.')) + ".txt";
+	Convert_Trajectories_To_Text(binary_filename, text_filename);
+	std::cout << "Converted " << binary_filename << " to " << text_filename << "." << std::endl;
+	return 0;
+}
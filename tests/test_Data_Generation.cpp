@@ -1,7 +1,9 @@
 #include "Data_Generation.hpp"
 
 #include "gtest/gtest.h"
+#include <fstream>
 #include <mpi.h>
+#include <numeric>
 
 #include "libphysica/Natural_Units.hpp"
 
@@ -16,7 +18,8 @@ int main(int argc, char* argv[])
 	int result = 0;
 
 	::testing::InitGoogleTest(&argc, argv);
-	MPI_Init(&argc, &argv);
+	int mpi_thread_support;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &mpi_thread_support);
 	result = RUN_ALL_TESTS();
 	MPI_Finalize();
 	return result;
@@ -59,6 +62,149 @@ TEST(TestDataGeneration, TestGenerateData)
 	ASSERT_EQ(data_set.data[0].size(), sample_size);
 }
 
+TEST(TestDataGeneration, TestGenerateDataThreads)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+
+	obscura::DM_Particle_SI DM(0.01 * GeV);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(1.0 * pb);
+	DM.Set_Sigma_Electron(1.0 * pb);
+
+	unsigned int sample_size = 10;
+
+	SSM.Interpolate_Total_DM_Scattering_Rate(DM, 100, 50);
+
+	// ACT
+	Simulation_Data data_set(sample_size);
+	data_set.Set_Number_Of_Threads(4);
+	data_set.Generate_Data(DM, SSM, SHM);
+
+	// ASSERT
+	ASSERT_GE(data_set.data[0].size(), sample_size);
+	EXPECT_LE(data_set.Free_Ratio() + data_set.Capture_Ratio() + data_set.Reflection_Ratio(), 1.0 + 1.0e-10);
+}
+
+TEST(TestDataGeneration, TestGenerateDataAllreduce)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+
+	obscura::DM_Particle_SI DM(0.01 * GeV);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(1.0 * pb);
+	DM.Set_Sigma_Electron(1.0 * pb);
+
+	unsigned int sample_size = 10;
+
+	SSM.Interpolate_Total_DM_Scattering_Rate(DM, 100, 50);
+
+	// ACT
+	Simulation_Data data_set(sample_size);
+	data_set.Set_Termination_Protocol("Allreduce");
+	data_set.Generate_Data(DM, SSM, SHM);
+
+	// ASSERT
+	// Each rank may overshoot the target by one in-flight batch, i.e. the trajectories simulated while starting and checking the deciding reduction.
+	int mpi_processes;
+	MPI_Comm_size(MPI_COMM_WORLD, &mpi_processes);
+	unsigned int in_flight_batch = 2;
+	ASSERT_GE(data_set.data[0].size(), sample_size);
+	EXPECT_LE(data_set.data[0].size(), sample_size + mpi_processes * in_flight_batch);
+}
+
+TEST(TestDataGeneration, TestGenerateDataImportanceSampling)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+
+	obscura::DM_Particle_SI DM(0.01 * GeV);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(1.0 * pb);
+	DM.Set_Sigma_Electron(1.0 * pb);
+
+	unsigned int sample_size = 20;
+
+	SSM.Interpolate_Total_DM_Scattering_Rate(DM, 100, 50);
+
+	// ACT
+	Simulation_Data data_set(sample_size);
+	data_set.Set_Importance_Sampling(1.0, 2.0);
+	data_set.Generate_Data(DM, SSM, SHM);
+
+	// ASSERT
+	double sum_weights = 0.0, sum_weights_sqr = 0.0;
+	for(auto& data_point : data_set.data[0])
+	{
+		sum_weights += data_point.weight;
+		sum_weights_sqr += data_point.weight * data_point.weight;
+	}
+	EXPECT_GE(data_set.Effective_Sample_Size(), sample_size);
+	EXPECT_NEAR(data_set.Effective_Sample_Size(), sum_weights * sum_weights / sum_weights_sqr, 1.0e-6 * data_set.Effective_Sample_Size());
+	EXPECT_GE(data_set.data[0].size(), data_set.Effective_Sample_Size());
+}
+
+TEST(TestDataGeneration, TestGenerateDataSplitting)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+
+	obscura::DM_Particle_SI DM(0.5 * GeV);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(0.1 * pb);
+
+	unsigned int sample_size = 20;
+
+	SSM.Interpolate_Total_DM_Scattering_Rate(DM, 100, 50);
+
+	// ACT
+	Simulation_Data data_set(sample_size);
+	data_set.Set_Splitting({200.0 * km / sec, 500.0 * km / sec});
+	data_set.Generate_Data(DM, SSM, SHM);
+
+	// ASSERT
+	double sum_weights = 0.0, sum_weights_sqr = 0.0;
+	for(auto& data_point : data_set.data[0])
+	{
+		sum_weights += data_point.weight;
+		sum_weights_sqr += data_point.weight * data_point.weight;
+	}
+	EXPECT_GE(data_set.Effective_Sample_Size(), sample_size);
+	// The copies of one initial condition count as one sample, so that the effective sample size cannot exceed the one of independent data points.
+	EXPECT_LE(data_set.Effective_Sample_Size(), sum_weights * sum_weights / sum_weights_sqr + 1.0e-6);
+}
+
+TEST(TestDataGeneration, TestGenerateDataBatches)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+
+	obscura::DM_Particle_SI DM(0.01 * GeV);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(1.0 * pb);
+	DM.Set_Sigma_Electron(1.0 * pb);
+
+	unsigned int sample_size = 10;
+
+	SSM.Interpolate_Total_DM_Scattering_Rate(DM, 100, 50);
+
+	// ACT
+	Simulation_Data data_set(sample_size);
+	data_set.Set_Number_Of_Threads(2);
+	data_set.Set_Batch_Simulation(8);
+	data_set.Generate_Data(DM, SSM, SHM, 31);
+
+	// ASSERT
+	ASSERT_GE(data_set.data[0].size(), sample_size);
+	EXPECT_LE(data_set.Free_Ratio() + data_set.Capture_Ratio() + data_set.Reflection_Ratio(), 1.0 + 1.0e-10);
+}
+
 TEST(TestDataGeneration, TestConfigure)
 {
 	// ARRANGE
@@ -170,6 +316,120 @@ TEST(TestDataGeneration, TestSpeedFunctions)
 	EXPECT_GT(data_set.Highest_Speed(), data_set.Lowest_Speed());
 }
 
+TEST(TestDataGeneration, TestGenerateDataStreaming)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+
+	obscura::DM_Particle_SI DM(1.0 * GeV);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(1.0 * pb);
+	DM.Set_Sigma_Electron(1.0 * pb);
+
+	SSM.Interpolate_Total_DM_Scattering_Rate(DM, 100, 50);
+
+	unsigned int sample_size = 50;
+	double u_min			 = 0.0001;
+	unsigned int bins		 = 200;
+	int fixed_seed			 = 17;
+	Simulation_Data data_set(sample_size, u_min);
+	Simulation_Data data_set_streaming(sample_size, u_min);
+	data_set_streaming.Set_Streaming_Histograms(bins);
+	// ACT
+	data_set.Generate_Data(DM, SSM, SHM, fixed_seed);
+	data_set_streaming.Generate_Data(DM, SSM, SHM, fixed_seed);
+	// ASSERT
+	EXPECT_FALSE(data_set.Streaming());
+	EXPECT_TRUE(data_set_streaming.Streaming());
+	EXPECT_LE(data_set_streaming.data[0].size(), bins);
+	EXPECT_NEAR(data_set_streaming.Reflection_Ratio(0), data_set.Reflection_Ratio(0), 1.0e-12);
+	EXPECT_NEAR(data_set_streaming.Effective_Sample_Size(), data_set.Effective_Sample_Size(), 1.0e-9);
+	EXPECT_DOUBLE_EQ(data_set_streaming.Lowest_Speed(), data_set.Lowest_Speed());
+	EXPECT_DOUBLE_EQ(data_set_streaming.Highest_Speed(), data_set.Highest_Speed());
+	EXPECT_GT(data_set_streaming.KDE_Bandwidth(), 0.0);
+	EXPECT_DOUBLE_EQ(data_set.KDE_Bandwidth(), 0.0);
+}
+
+TEST(TestDataGeneration, TestStreamingHistogramOverflow)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+	obscura::DM_Particle_SI DM(1.0 * GeV);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(1.0 * pb);
+	DM.Set_Sigma_Electron(1.0 * pb);
+
+	SSM.Interpolate_Total_DM_Scattering_Rate(DM, 100, 50);
+
+	unsigned int sample_size = 50;
+	double u_min			 = 0.0001;
+	double maximum_speed	 = 500.0 * km / sec;
+	int fixed_seed			 = 17;
+	Simulation_Data data_set(sample_size, u_min);
+	Simulation_Data data_set_streaming(sample_size, u_min);
+	data_set_streaming.Set_Streaming_Histograms(100, maximum_speed);
+	// ACT
+	data_set.Generate_Data(DM, SSM, SHM, fixed_seed);
+	data_set_streaming.Generate_Data(DM, SSM, SHM, fixed_seed);
+	// ASSERT
+	// The histogram holds exactly the data points up to the maximum speed, and the rest is overflow.
+	double weight_binned = 0.0, weight_overflow = 0.0;
+	for(auto& data_point : data_set.data[0])
+	{
+		if(data_point.value < maximum_speed)
+			weight_binned += data_point.weight;
+		else
+			weight_overflow += data_point.weight;
+	}
+	std::vector<double> bins = data_set_streaming.Histogram_Weights();
+	ASSERT_GT(weight_overflow, 0.0);
+	EXPECT_NEAR(std::accumulate(bins.begin(), bins.end(), 0.0), weight_binned, 1.0e-9 * weight_binned);
+	EXPECT_NEAR(data_set_streaming.Histogram_Overflow(), weight_overflow / (weight_binned + weight_overflow), 1.0e-9);
+	EXPECT_DOUBLE_EQ(data_set.Histogram_Overflow(), 0.0);
+}
+
+TEST(TestDataGeneration, TestDataReduction)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+
+	obscura::DM_Particle_SI DM(1.0 * GeV);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(1.0 * pb);
+	DM.Set_Sigma_Electron(1.0 * pb);
+
+	SSM.Interpolate_Total_DM_Scattering_Rate(DM, 100, 50);
+
+	unsigned int sample_size = 20;
+	double u_min			 = 0.0001;
+	int fixed_seed			 = 18;
+	Simulation_Data data_set(sample_size, u_min);
+	Simulation_Data data_set_gather(sample_size, u_min);
+	Simulation_Data data_set_mpi_io(sample_size, u_min);
+	data_set_gather.Set_Data_Reduction("Gather");
+	data_set_mpi_io.Set_Data_Reduction("MPI-IO", "test_reflection_data.bin");
+	// ACT
+	data_set.Generate_Data(DM, SSM, SHM, fixed_seed);
+	data_set_gather.Generate_Data(DM, SSM, SHM, fixed_seed);
+	data_set_mpi_io.Generate_Data(DM, SSM, SHM, fixed_seed);
+	// ASSERT
+	EXPECT_TRUE(data_set_gather.Data_Available());
+	EXPECT_TRUE(data_set_mpi_io.Data_Available());
+	ASSERT_EQ(data_set_gather.data[0].size(), data_set.data[0].size());
+	ASSERT_EQ(data_set_mpi_io.data[0].size(), data_set.data[0].size());
+	for(unsigned int i = 0; i < data_set.data[0].size(); i++)
+	{
+		EXPECT_DOUBLE_EQ(data_set_gather.data[0][i].value, data_set.data[0][i].value);
+		EXPECT_DOUBLE_EQ(data_set_mpi_io.data[0][i].value, data_set.data[0][i].value);
+		EXPECT_DOUBLE_EQ(data_set_mpi_io.data[0][i].weight, data_set.data[0][i].weight);
+	}
+	EXPECT_DOUBLE_EQ(data_set_mpi_io.Reflection_Ratio(0), data_set.Reflection_Ratio(0));
+	EXPECT_FALSE(std::ifstream("test_reflection_data.bin").good());
+}
+
 // TEST(TestDataGeneration, TestDataSetPrintSummary)
 // {
 // 	// ARRANGE
@@ -1,9 +1,11 @@
 #include "Parameter_Scan.hpp"
 
 #include "gtest/gtest.h"
+#include <cstdio>
 #include <mpi.h>
 
 #include "libphysica/Natural_Units.hpp"
+#include "libphysica/Utilities.hpp"
 
 using namespace DaMaSCUS_SUN;
 using namespace libphysica::natural_units;
@@ -32,6 +34,23 @@ TEST(TestParameterScan, TestConfiguration)
 	EXPECT_EQ(cfg.cross_sections, 5);
 	EXPECT_EQ(cfg.interpolation_points, 150);
 	EXPECT_EQ(cfg.isoreflection_rings, 3);
+	EXPECT_EQ(cfg.threads_per_process, 1);
+	EXPECT_EQ(cfg.termination_protocol, "Ring");
+	EXPECT_EQ(cfg.data_reduction, "Allgather");
+	EXPECT_DOUBLE_EQ(cfg.importance_sampling_speed_exponent, 0.0);
+	EXPECT_DOUBLE_EQ(cfg.importance_sampling_impact_parameter_exponent, 1.0);
+	EXPECT_TRUE(cfg.splitting_speeds.empty());
+	EXPECT_EQ(cfg.splitting_factor, 2);
+	EXPECT_EQ(cfg.batch_lanes, 0);
+	EXPECT_EQ(cfg.histogram_bins, 0);
+	EXPECT_DOUBLE_EQ(cfg.histogram_maximum_speed, 0.02);
+	EXPECT_FALSE(cfg.capture_short_circuit);
+	EXPECT_EQ(cfg.capture_collisions, 10);
+	EXPECT_FALSE(cfg.optical_depth_sampling);
+	EXPECT_FALSE(cfg.diffusion_acceleration);
+	EXPECT_FALSE(cfg.binned_KDE);
+	EXPECT_TRUE(cfg.rate_table_cache_directory.empty());
+	EXPECT_EQ(cfg.scan_process_groups, 1);
 }
 
 TEST(TestParameterScan, TestConfigurationSummary)
@@ -54,11 +73,130 @@ TEST(TestParameterScan, TestSTAScan)
 	scan.Print_Grid();
 	// ASSERT
 	ASSERT_GT(limit_curve.size(), 0);
+	EXPECT_EQ(scan.Speculative_Evaluations(), 0);
+	EXPECT_EQ(scan.Wasted_Evaluations(), 0);
 	// for(auto& row : scan.p_value_grid)
 	// 	for(auto& entry : row)
 	// 		ASSERT_GE(entry, 0.0);
 }
 
+TEST(TestParameterScan, TestSTAFrontier)
+{
+	// ARRANGE
+	std::vector<double> masses	  = libphysica::Log_Space(1.0e-5 * GeV, 1.0e-2 * GeV, 5);
+	std::vector<double> couplings = libphysica::Log_Space(1.0e-35 * cm * cm, 1.0e-32 * cm * cm, 5);
+	Parameter_Scan scan(masses, couplings, "unit_tests_frontier", 50);
+	// ACT
+	std::vector<std::vector<int>> frontier	   = scan.STA_Frontier(4, 4, "W", false, 5);
+	std::vector<std::vector<int>> single_point = scan.STA_Frontier(4, 4, "W", false, 1);
+	// ASSERT
+	// The current point, its two branches (left turn first), and their branches, where (3,3) is reached twice.
+	std::vector<std::vector<int>> expected_frontier = {{4, 4}, {3, 4}, {4, 3}, {3, 3}, {4, 2}};
+	EXPECT_EQ(frontier, expected_frontier);
+	ASSERT_EQ(single_point.size(), 1);
+	EXPECT_EQ(single_point[0], std::vector<int>({4, 4}));
+}
+
+TEST(TestParameterScan, TestSTAScanProcessGroups)
+{
+	// ARRANGE
+	// The concurrent evaluation needs at least two MPI processes, see tests/CMakeLists.txt.
+	int mpi_rank, mpi_processes;
+	MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &mpi_processes);
+	if(mpi_processes < 2)
+		GTEST_SKIP();
+	Configuration cfg(PROJECT_DIR "tests/config_unittest_groups.cfg", mpi_rank);
+	Solar_Model SSM;
+	if(mpi_rank == 0)
+		std::remove(TOP_LEVEL_DIR "results/unit_tests_groups/P_Values_Grid.txt");
+	MPI_Barrier(MPI_COMM_WORLD);
+	// ACT
+	Parameter_Scan scan(cfg);
+	scan.Perform_STA_Scan(*cfg.DM, *cfg.DM_detector, SSM, *cfg.DM_distr, mpi_rank);
+	std::vector<std::vector<double>> limit_curve = scan.Limit_Curve();
+	// ASSERT
+	ASSERT_GT(limit_curve.size(), 0);
+	EXPECT_GT(scan.Speculative_Evaluations(), 0);
+	EXPECT_LE(scan.Wasted_Evaluations(), scan.Speculative_Evaluations());
+	// All processes end up with the same limit.
+	unsigned long int limit_points = limit_curve.size();
+	MPI_Bcast(&limit_points, 1, MPI_UNSIGNED_LONG, 0, MPI_COMM_WORLD);
+	ASSERT_EQ(limit_curve.size(), limit_points);
+	for(auto& point : limit_curve)
+	{
+		std::vector<double> point_root = point;
+		MPI_Bcast(point_root.data(), point_root.size(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+		EXPECT_EQ(point, point_root);
+	}
+}
+
+TEST(TestParameterScan, TestFullScanQueue)
+{
+	// ARRANGE
+	std::vector<std::vector<double>> grid(4, std::vector<double>(3, -1.0));
+	grid[2][0] = 0.5;
+	std::vector<std::vector<double>> grid_complete_row(4, std::vector<double>(3, -1.0));
+	grid_complete_row[3] = {0.5, 0.5, 0.5};
+	// ACT
+	Full_Scan_Queue queue(grid, 0.05);
+	Full_Scan_Queue queue_complete_row(grid_complete_row, 0.05);
+	std::vector<std::vector<int>> points;
+	for(int i = 0; i < 5; i++)
+		points.push_back(queue.Next_Point());
+	queue.Add_Result(3, 2, 0.5);
+	queue.Add_Result(3, 1, 0.01);
+	queue.Add_Result(3, 0, 0.5);
+	queue.Add_Result(2, 2, 0.5);
+	bool finished_before_last_point = queue.Finished();
+	queue.Add_Result(2, 1, 0.5);
+	queue.Fill_Remaining_Rows();
+	// ASSERT
+	// Row by row from the top, each from the right, without the imported point (2,0).
+	std::vector<std::vector<int>> expected_points = {{3, 2}, {3, 1}, {3, 0}, {2, 2}, {2, 1}};
+	EXPECT_EQ(points, expected_points);
+	EXPECT_FALSE(finished_before_last_point);
+	EXPECT_TRUE(queue.Finished());
+	EXPECT_EQ(queue.Next_Point(), std::vector<int>({-1, -1}));
+	EXPECT_DOUBLE_EQ(grid[2][0], 0.5);
+	for(int row = 0; row < 2; row++)
+		for(auto& p : grid[row])
+			EXPECT_DOUBLE_EQ(p, 1.0);
+	EXPECT_TRUE(queue_complete_row.Finished());
+	EXPECT_EQ(queue_complete_row.Next_Point(), std::vector<int>({-1, -1}));
+}
+
+TEST(TestParameterScan, TestFullScanProcessGroups)
+{
+	// ARRANGE
+	// The work queue needs process 0 and at least two groups, see tests/CMakeLists.txt.
+	int mpi_rank, mpi_processes;
+	MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &mpi_processes);
+	if(mpi_processes < 3)
+		GTEST_SKIP();
+	Configuration cfg(PROJECT_DIR "tests/config_unittest_groups.cfg", mpi_rank);
+	Solar_Model SSM;
+	if(mpi_rank == 0)
+		std::remove(TOP_LEVEL_DIR "results/unit_tests_groups/P_Values_Grid.txt");
+	MPI_Barrier(MPI_COMM_WORLD);
+	// ACT
+	Parameter_Scan scan(cfg);
+	scan.Perform_Full_Scan(*cfg.DM, *cfg.DM_detector, SSM, *cfg.DM_distr, mpi_rank);
+	std::vector<std::vector<double>> limit_curve = scan.Limit_Curve();
+	// ASSERT
+	ASSERT_GT(limit_curve.size(), 0);
+	unsigned long int limit_points = limit_curve.size();
+	MPI_Bcast(&limit_points, 1, MPI_UNSIGNED_LONG, 0, MPI_COMM_WORLD);
+	ASSERT_EQ(limit_curve.size(), limit_points);
+	for(auto& point : limit_curve)
+	{
+		std::vector<double> point_root = point;
+		MPI_Bcast(point_root.data(), point_root.size(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+		EXPECT_EQ(point, point_root);
+	}
+}
+
 TEST(TestParameterScan, TestFullScan)
 {
 	// ARRANGE
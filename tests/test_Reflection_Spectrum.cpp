@@ -2,9 +2,12 @@
 
 #include "gtest/gtest.h"
 #include <mpi.h>
+#include <random>
+#include <vector>
 
 #include "libphysica/Integration.hpp"
 #include "libphysica/Natural_Units.hpp"
+#include "libphysica/Statistics.hpp"
 
 #include "obscura/DM_Halo_Models.hpp"
 #include "obscura/DM_Particle_Standard.hpp"
@@ -70,4 +73,84 @@ TEST(TestReflectionSpectrum, TestDMEnteringRate)
 	// ASSERT
 	ASSERT_DOUBLE_EQ(rate_1, 2.0 * rate_2);
 	ASSERT_NEAR(rate_1, 1.06689e+30 / sec, 1.0e27 / sec);
-}
\ No newline at end of file
+}
+
+TEST(TestReflectionSpectrum, TestSpectrumBinnedKDE)
+{
+	// ARRANGE
+	Solar_Model solar_model;
+	obscura::Standard_Halo_Model SHM;
+
+	double mDM = 0.1;
+	obscura::DM_Particle_SI DM(mDM);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(1e-1 * pb);
+
+	solar_model.Interpolate_Total_DM_Scattering_Rate(DM, 100, 50);
+	Simulation_Data data_set(10, 0, 1);
+	int fixed_seed = 13;
+	data_set.Generate_Data(DM, solar_model, SHM, fixed_seed);
+	// ACT
+	Reflection_Spectrum spectrum(data_set, solar_model, SHM, mDM, 0, true);
+	// ASSERT
+	std::function<double(double)> pdf = [&spectrum](double v) {
+		return spectrum.PDF_Speed(v);
+	};
+	double norm = libphysica::Integrate(pdf, spectrum.Minimum_DM_Speed(), spectrum.Maximum_DM_Speed());
+	EXPECT_NEAR(norm, 1.0, 1e-3);
+}
+
+TEST(TestReflectionSpectrum, TestPerformBinnedKDE)
+{
+	// ARRANGE
+	std::mt19937 PRNG(14);
+	std::normal_distribution<double> distribution(0.5, 0.1);
+	std::exponential_distribution<double> distribution_boundary(5.0);
+	std::vector<libphysica::DataPoint> data, data_boundary;
+	for(int i = 0; i < 2000; i++)
+	{
+		data.push_back(libphysica::DataPoint(distribution(PRNG), 1.0 + i % 3));
+		double x = distribution_boundary(PRNG);
+		if(x < 1.0)
+			data_boundary.push_back(libphysica::DataPoint(x, 1.0 + i % 3));
+	}
+	double bandwidth = 0.03;
+	// ACT
+	libphysica::Interpolation kde_binned		  = Perform_Binned_KDE(data, 0.0, 1.0, bandwidth);
+	libphysica::Interpolation kde_direct		  = libphysica::Perform_KDE(data, 0.0, 1.0, bandwidth);
+	libphysica::Interpolation kde_binned_boundary = Perform_Binned_KDE(data_boundary, 0.0, 1.0, bandwidth);
+	libphysica::Interpolation kde_direct_boundary = libphysica::Perform_KDE(data_boundary, 0.0, 1.0, bandwidth);
+	// ASSERT
+	for(double x = 0.3; x < 0.7; x += 0.05)
+		EXPECT_NEAR(kde_binned(x), kde_direct(x), 0.02 * kde_direct(x));
+	// The boundary correction at x_min, where the density is largest, within a grid spacing, and within a few bandwidths
+	for(double x : {0.0, 0.0005, 0.001, 0.01, 0.03, 0.06, 0.1})
+		EXPECT_NEAR(kde_binned_boundary(x), kde_direct_boundary(x), 0.03 * kde_direct_boundary(x));
+}
+
+TEST(TestReflectionSpectrum, TestPerformHistogramKDE)
+{
+	// ARRANGE
+	std::mt19937 PRNG(15);
+	std::exponential_distribution<double> distribution(5.0);
+	std::vector<libphysica::DataPoint> data;
+	unsigned int bins = 200;
+	double bin_width  = 1.0 / bins;
+	std::vector<double> bin_weights(bins, 0.0);
+	for(int i = 0; i < 2000; i++)
+	{
+		double x = distribution(PRNG);
+		if(x < 1.0)
+		{
+			data.push_back(libphysica::DataPoint(x, 1.0 + i % 3));
+			bin_weights[x / bin_width] += 1.0 + i % 3;
+		}
+	}
+	double bandwidth = 0.03;
+	// ACT
+	libphysica::Interpolation kde_histogram = Perform_Histogram_KDE(bin_weights, 0.0, 1.0, bin_width, bandwidth);
+	libphysica::Interpolation kde_direct	= libphysica::Perform_KDE(data, 0.0, 1.0, bandwidth);
+	// ASSERT
+	for(double x : {0.0, 0.01, 0.03, 0.06, 0.1, 0.2, 0.3})
+		EXPECT_NEAR(kde_histogram(x), kde_direct(x), 0.03 * kde_direct(x));
+}
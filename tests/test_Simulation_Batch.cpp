@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+
+#include "libphysica/Natural_Units.hpp"
+
+#include "obscura/DM_Halo_Models.hpp"
+#include "obscura/DM_Particle_Standard.hpp"
+
+#include "Simulation_Batch.hpp"
+#include "Simulation_Trajectory.hpp"
+#include "Simulation_Utilities.hpp"
+
+using namespace DaMaSCUS_SUN;
+using namespace libphysica::natural_units;
+
+TEST(TestSimulationBatch, TestConstructor)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	// ACT
+	Trajectory_Batch_Simulator simulator(SSM, 16);
+	Trajectory_Batch_Simulator simulator_zero_lanes(SSM, 0);
+	// ASSERT
+	EXPECT_EQ(simulator.Lanes(), 16);
+	EXPECT_EQ(simulator_zero_lanes.Lanes(), 1);
+	EXPECT_DOUBLE_EQ(simulator.maximum_distance, 1.1 * rSun);
+}
+
+TEST(TestSimulationBatch, TestSimulateFreeParticles)
+{
+	// ARRANGE
+	obscura::DM_Particle_SI DM(0.5 * GeV);
+	DM.Set_Sigma_Proton(0.0);
+	Solar_Model SSM;
+	Trajectory_Simulator scalar_simulator(SSM);
+	Trajectory_Batch_Simulator batch_simulator(SSM, 4);
+	obscura::Standard_Halo_Model SHM;
+	std::vector<Event> initial_conditions;
+	for(int i = 0; i < 10; i++)
+	{
+		initial_conditions.push_back(Initial_Conditions(SHM, SSM, scalar_simulator.PRNG));
+		Hyperbolic_Kepler_Shift(initial_conditions.back(), 1.5 * rSun);
+	}
+	// ACT
+	std::vector<Trajectory_Result> results = batch_simulator.Simulate(initial_conditions, DM);
+	// ASSERT
+	ASSERT_EQ(results.size(), initial_conditions.size());
+	for(unsigned int i = 0; i < results.size(); i++)
+	{
+		Trajectory_Result scalar_result = scalar_simulator.Simulate(initial_conditions[i], DM);
+		ASSERT_TRUE(results[i].Particle_Free());
+		EXPECT_EQ(results[i].number_of_scatterings, 0);
+		EXPECT_DOUBLE_EQ(results[i].initial_event.time, initial_conditions[i].time);
+		for(int j = 0; j < 3; j++)
+		{
+			EXPECT_NEAR(results[i].final_event.position[j], scalar_result.final_event.position[j], 1.0e-6 * rSun);
+			EXPECT_NEAR(results[i].final_event.velocity[j], scalar_result.final_event.velocity[j], 1.0e-3 * km / sec);
+		}
+	}
+}
+
+TEST(TestSimulationBatch, TestSimulate)
+{
+	// ARRANGE
+	obscura::DM_Particle_SI DM(0.5 * GeV);
+	DM.Set_Sigma_Proton(0.1 * pb);
+	Solar_Model SSM;
+	Trajectory_Batch_Simulator simulator(SSM, 8);
+	simulator.Fix_PRNG_Seed(11);
+	obscura::Standard_Halo_Model SHM;
+	std::mt19937 PRNG(12);
+	std::vector<Event> initial_conditions;
+	for(int i = 0; i < 20; i++)
+	{
+		initial_conditions.push_back(Initial_Conditions(SHM, SSM, PRNG));
+		Hyperbolic_Kepler_Shift(initial_conditions.back(), 1.5 * rSun);
+	}
+	// ACT
+	std::vector<Trajectory_Result> results = simulator.Simulate(initial_conditions, DM);
+	// ASSERT
+	ASSERT_EQ(results.size(), initial_conditions.size());
+	for(auto& result : results)
+	{
+		if(result.Particle_Reflected() || result.Particle_Free())
+			ASSERT_NEAR(result.final_event.Radius(), simulator.maximum_distance, 0.01 * rSun);
+		else
+			ASSERT_GT(result.number_of_scatterings, 0);
+	}
+}
+
+TEST(TestSimulationBatch, TestSimulateDistributions)
+{
+	// ARRANGE
+	obscura::DM_Particle_SI DM(0.5 * GeV);
+	DM.Set_Sigma_Proton(pb);
+	Solar_Model SSM;
+	Trajectory_Simulator scalar_simulator(SSM);
+	Trajectory_Batch_Simulator batch_simulator(SSM, 8);
+	obscura::Standard_Halo_Model SHM;
+	int trials = 2000;
+	std::vector<Event> initial_conditions;
+	std::vector<std::mt19937> PRNGs(trials);
+	for(int i = 0; i < trials; i++)
+	{
+		Seed_PRNG_Stream(PRNGs[i], 23, 0, i);
+		initial_conditions.push_back(Initial_Conditions(SHM, SSM, PRNGs[i]));
+		Hyperbolic_Kepler_Shift(initial_conditions.back(), 1.5 * rSun);
+	}
+	std::vector<std::mt19937> scalar_PRNGs = PRNGs;
+	// ACT
+	// Both paths continue the same random number streams, but their free propagations take different steps. Only the distributions of the results agree.
+	std::vector<std::vector<Trajectory_Result>> results(2);
+	results[0] = batch_simulator.Simulate(initial_conditions, PRNGs, DM);
+	for(int i = 0; i < trials; i++)
+	{
+		scalar_simulator.PRNG = scalar_PRNGs[i];
+		results[1].push_back(scalar_simulator.Simulate(initial_conditions[i], DM));
+	}
+	// ASSERT
+	std::vector<double> reflections(2, 0.0), speed_sums(2, 0.0), speed_squared_sums(2, 0.0);
+	for(unsigned int j = 0; j < 2; j++)
+		for(auto& result : results[j])
+			if(result.Particle_Reflected())
+			{
+				double v = result.final_event.Speed();
+				reflections[j]++;
+				speed_sums[j] += v;
+				speed_squared_sums[j] += v * v;
+			}
+	ASSERT_GT(reflections[0], 30);
+	ASSERT_GT(reflections[1], 30);
+	double reflection_ratio = (reflections[0] + reflections[1]) / 2.0 / trials;
+	EXPECT_NEAR(reflections[0] / trials, reflections[1] / trials, 4.0 * sqrt(2.0 * reflection_ratio * (1.0 - reflection_ratio) / trials));
+	std::vector<double> mean_speeds(2), speed_variances(2);
+	for(unsigned int j = 0; j < 2; j++)
+	{
+		mean_speeds[j]	   = speed_sums[j] / reflections[j];
+		speed_variances[j] = speed_squared_sums[j] / reflections[j] - mean_speeds[j] * mean_speeds[j];
+	}
+	EXPECT_NEAR(mean_speeds[0], mean_speeds[1], 4.0 * sqrt(speed_variances[0] / reflections[0] + speed_variances[1] / reflections[1]));
+	EXPECT_NEAR(sqrt(speed_variances[0]), sqrt(speed_variances[1]), 0.25 * sqrt(speed_variances[1]));
+}
@@ -147,6 +147,212 @@ TEST(TestSimulationTrajectory, TestSimulate)
 	}
 }
 
+TEST(TestSimulationTrajectory, TestSimulateAnalyticKeplerOrbits)
+{
+	// ARRANGE
+	obscura::DM_Particle_SI DM(0.5 * GeV);
+	DM.Set_Sigma_Proton(0.0);
+	Solar_Model SSM;
+	Trajectory_Simulator simulator_analytic(SSM);
+	Trajectory_Simulator simulator_numeric(SSM);
+	simulator_numeric.analytic_kepler_orbits = false;
+	obscura::Standard_Halo_Model SHM;
+	// ACT & ASSERT
+	int trials = 5;
+	for(int i = 0; i < trials; i++)
+	{
+		Event IC = Initial_Conditions(SHM, SSM, simulator_analytic.PRNG);
+		Hyperbolic_Kepler_Shift(IC, 1.5 * rSun);
+		Trajectory_Result result_analytic = simulator_analytic.Simulate(IC, DM);
+		Trajectory_Result result_numeric  = simulator_numeric.Simulate(IC, DM);
+		ASSERT_TRUE(result_analytic.Particle_Free());
+		ASSERT_NEAR(result_analytic.final_event.Radius(), simulator_analytic.maximum_distance, 1.0e-6 * rSun);
+		for(int j = 0; j < 3; j++)
+			ASSERT_NEAR(result_analytic.final_event.position[j], result_numeric.final_event.position[j], 0.01 * rSun);
+		for(int j = 0; j < 3; j++)
+			ASSERT_NEAR(result_analytic.final_event.velocity[j], result_numeric.final_event.velocity[j], km / sec);
+		ASSERT_NEAR(result_analytic.final_event.time, result_numeric.final_event.time, minute);
+	}
+}
+
+TEST(TestSimulationTrajectory, TestSimulateSharedSolarModel)
+{
+	// ARRANGE
+	obscura::DM_Particle_SI DM(0.5 * GeV);
+	DM.Set_Sigma_Proton(0.1 * pb);
+	const Solar_Model SSM;
+	Trajectory_Simulator simulator_1(SSM);
+	Trajectory_Simulator simulator_2(SSM);
+	simulator_1.Fix_PRNG_Seed(42);
+	simulator_2.Fix_PRNG_Seed(42);
+	obscura::Standard_Halo_Model SHM;
+	std::mt19937 PRNG(7);
+	// ACT & ASSERT
+	int trials = 3;
+	for(int i = 0; i < trials; i++)
+	{
+		Event IC = Initial_Conditions(SHM, SSM, PRNG);
+		Hyperbolic_Kepler_Shift(IC, 1.5 * rSun);
+		Trajectory_Result result_1 = simulator_1.Simulate(IC, DM);
+		Trajectory_Result result_2 = simulator_2.Simulate(IC, DM);
+		ASSERT_EQ(result_1.number_of_scatterings, result_2.number_of_scatterings);
+		ASSERT_DOUBLE_EQ(result_1.final_event.time, result_2.final_event.time);
+		ASSERT_DOUBLE_EQ(result_1.final_event.Radius(), result_2.final_event.Radius());
+	}
+}
+
+TEST(TestSimulationTrajectory, TestSimulateOpticalDepthSampling)
+{
+	// ARRANGE
+	obscura::DM_Particle_SI DM(0.5 * GeV);
+	DM.Set_Sigma_Proton(100.0 * pb);
+	Solar_Model SSM;
+	// With no scatterings allowed, the final event of a trajectory is its first scattering point.
+	// Both simulators draw one random number per trajectory, so the shared seed gives every trajectory the same optical depth in both methods.
+	Trajectory_Simulator simulator_euler(SSM, 1e8, 0);
+	Trajectory_Simulator simulator_optical_depth(SSM, 1e8, 0);
+	simulator_optical_depth.optical_depth_sampling = true;
+	simulator_euler.Fix_PRNG_Seed(3);
+	simulator_optical_depth.Fix_PRNG_Seed(3);
+	obscura::Standard_Halo_Model SHM;
+	std::mt19937 PRNG(7);
+	// ACT
+	int trials				= 1000;
+	int scatterings			= 0;
+	int mismatches			= 0;
+	double radius_deviation = 0.0;
+	for(int i = 0; i < trials; i++)
+	{
+		Event IC = Initial_Conditions(SHM, SSM, PRNG);
+		Hyperbolic_Kepler_Shift(IC, 1.5 * rSun);
+		double radius_euler			= simulator_euler.Simulate(IC, DM).final_event.Radius();
+		double radius_optical_depth = simulator_optical_depth.Simulate(IC, DM).final_event.Radius();
+		if((radius_euler < rSun) != (radius_optical_depth < rSun))
+			mismatches++;
+		else if(radius_euler < rSun)
+		{
+			scatterings++;
+			radius_deviation += fabs(radius_optical_depth - radius_euler);
+		}
+	}
+	// ASSERT
+	ASSERT_GT(scatterings, 0);
+	EXPECT_LE(mismatches, 0.05 * trials);
+	EXPECT_LT(radius_deviation / scatterings, 0.025 * rSun);
+}
+
+TEST(TestSimulationTrajectory, TestSimulateDiffusionAcceleration)
+{
+	// ARRANGE
+	obscura::DM_Particle_SI DM(0.5 * GeV);
+	DM.Set_Sigma_Proton(1.0e4 * pb);
+	Solar_Model SSM;
+	Trajectory_Simulator simulator(SSM, 1e8, 1000);
+	simulator.diffusion_acceleration = true;
+	simulator.Fix_PRNG_Seed(13);
+	Event IC(0.0, libphysica::Vector({0.1 * rSun, 0.0, 0.0}), libphysica::Vector({0.0, 100.0 * km / sec, 0.0}));
+	// ACT
+	Trajectory_Result result = simulator.Simulate(IC, DM);
+	// ASSERT
+	EXPECT_GT(simulator.Diffusion_Steps(), 0);
+	EXPECT_EQ(result.number_of_scatterings, simulator.maximum_scatterings);
+	EXPECT_LT(result.final_event.Radius(), rSun);
+	EXPECT_GT(result.final_event.time, IC.time);
+}
+
+TEST(TestSimulationTrajectory, TestSimulateDiffusionAccelerationDisplacement)
+{
+	// ARRANGE
+	obscura::DM_Particle_SI DM(0.5 * GeV);
+	DM.Set_Sigma_Proton(1.0e4 * pb);
+	Solar_Model SSM;
+	SSM.Interpolate_Total_DM_Scattering_Rate(DM, 100, 50);
+	unsigned int maximum_scatterings = 200;
+	Trajectory_Simulator simulator_step_by_step(SSM, 1e8, maximum_scatterings);
+	Trajectory_Simulator simulator_diffusion(SSM, 1e8, maximum_scatterings);
+	simulator_diffusion.diffusion_acceleration = true;
+	simulator_step_by_step.Fix_PRNG_Seed(17);
+	simulator_diffusion.Fix_PRNG_Seed(19);
+	Event IC(0.0, libphysica::Vector({0.1 * rSun, 0.0, 0.0}), libphysica::Vector({0.0, 100.0 * km / sec, 0.0}));
+	// ACT
+	// Both random walks end after the same number of collisions, so their final positions should spread alike around the initial one.
+	unsigned int trials					= 50;
+	double squared_displacement_sums[2]	= {0.0, 0.0};
+	for(unsigned int i = 0; i < trials; i++)
+	{
+		Trajectory_Result results[2] = {simulator_step_by_step.Simulate(IC, DM), simulator_diffusion.Simulate(IC, DM)};
+		for(int j = 0; j < 2; j++)
+		{
+			ASSERT_EQ(results[j].number_of_scatterings, maximum_scatterings);
+			squared_displacement_sums[j] += (results[j].final_event.position - IC.position).Norm() * (results[j].final_event.position - IC.position).Norm();
+		}
+	}
+	// ASSERT
+	// The accelerated walks simulate only their first collision individually, before a single diffusion step covers the rest.
+	EXPECT_EQ(simulator_step_by_step.Diffusion_Steps(), 0);
+	EXPECT_EQ(simulator_diffusion.Diffusion_Steps(), trials);
+	double ratio = squared_displacement_sums[1] / squared_displacement_sums[0];
+	EXPECT_GT(ratio, 0.5);
+	EXPECT_LT(ratio, 2.0);
+}
+
+TEST(TestSimulationTrajectory, TestSimulateCaptureShortCircuit)
+{
+	// ARRANGE
+	obscura::DM_Particle_SI DM(100.0 * GeV);
+	DM.Set_Sigma_Proton(pb);
+	Solar_Model SSM;
+	Trajectory_Simulator simulator(SSM, 1e8, 100);
+	simulator.capture_short_circuit = true;
+	Event IC(0.0, libphysica::Vector({0.1 * rSun, 0.0, 0.0}), libphysica::Vector({0.0, 100.0 * km / sec, 0.0}));
+	// ACT
+	Trajectory_Result result = simulator.Simulate(IC, DM);
+	// ASSERT
+	EXPECT_EQ(result.number_of_scatterings, 1);
+	EXPECT_EQ(simulator.Short_Circuited_Trajectories(), 1);
+	EXPECT_TRUE(result.Particle_Captured(SSM));
+}
+
+TEST(TestSimulationTrajectory, TestSimulateSplitting)
+{
+	// ARRANGE
+	obscura::DM_Particle_SI DM(0.5 * GeV);
+	DM.Set_Sigma_Proton(0.1 * pb);
+	Solar_Model SSM;
+	Trajectory_Simulator simulator(SSM);
+	simulator.splitting_speeds = {200.0 * km / sec, 500.0 * km / sec};
+	simulator.Fix_PRNG_Seed(17);
+	obscura::Standard_Halo_Model SHM;
+	std::mt19937 PRNG(19);
+	// ACT
+	int trials				 = 5000;
+	unsigned int results	 = 0;
+	unsigned int unit_weight = 0;
+	double weight_sum		 = 0.0;
+	for(int i = 0; i < trials; i++)
+	{
+		Event IC = Initial_Conditions(SHM, SSM, PRNG);
+		Hyperbolic_Kepler_Shift(IC, 1.5 * rSun);
+		std::vector<Trajectory_Result> trajectories = {simulator.Simulate(IC, DM)};
+		while(simulator.Split_Particles_Pending())
+			trajectories.push_back(simulator.Simulate_Split_Particle(DM));
+		for(auto& trajectory : trajectories)
+		{
+			results++;
+			weight_sum += trajectory.weight / trials;
+			if(trajectory.weight == 1.0)
+				unit_weight++;
+			ASSERT_GE(trajectory.weight, 0.0);
+			// The first scattering only sets the splitting level.
+			EXPECT_TRUE(trajectory.number_of_scatterings > 1 || trajectory.weight == 1.0);
+		}
+	}
+	// ASSERT
+	EXPECT_LT(unit_weight, results);
+	EXPECT_NEAR(weight_sum, 1.0, 0.05);
+	EXPECT_FALSE(simulator.Split_Particles_Pending());
+}
+
 TEST(TestSimulationTrajectory, TestSimulatorPrintSummary)
 {
 	// ARRANGE
@@ -183,6 +389,52 @@ TEST(TestSimulationTrajectory, TestRungeKuttaStep)
 	EXPECT_LT(propagator.Current_Speed(), event.Speed());
 }
 
+TEST(TestSimulationTrajectory, TestRungeKuttaStepRejections)
+{
+	// ARRANGE
+	double t = 0;
+	libphysica::Vector r({0.25 * rSun, 0.5 * rSun, 0.25 * rSun});
+	libphysica::Vector v({km / sec, 1000 * km / sec, km / sec});
+	Event event(t, r, v);
+	Free_Particle_Propagator propagator(event);
+	propagator.time_step = 1.0e4 * sec;
+	// ACT
+	propagator.Runge_Kutta_45_Step(mSun);
+	// ASSERT
+	EXPECT_EQ(propagator.Accepted_Steps(), 1);
+	EXPECT_GT(propagator.Rejected_Steps(), 0);
+	EXPECT_LE(propagator.Rejected_Steps(), propagator.maximum_step_rejections);
+	EXPECT_LT(propagator.Current_Time(), 1.0e4 * sec);
+}
+
+TEST(TestSimulationTrajectory, TestPropagatorInterpolateLastStep)
+{
+	// ARRANGE
+	double t = 0;
+	libphysica::Vector r({0.25 * rSun, 0.5 * rSun, 0.25 * rSun});
+	libphysica::Vector v({km / sec, 1000 * km / sec, km / sec});
+	Event event(t, r, v);
+	Free_Particle_Propagator propagator(event);
+	propagator.Runge_Kutta_45_Step(mSun);
+	double r_after = propagator.Current_Radius();
+	double v_after = propagator.Current_Speed();
+	double r_interpolated, v_interpolated;
+	// ACT & ASSERT
+	propagator.Interpolate_Last_Step(0.0, r_interpolated, v_interpolated);
+	EXPECT_NEAR(r_interpolated, event.Radius(), 1.0e-9 * rSun);
+	EXPECT_NEAR(v_interpolated, event.Speed(), 1.0e-9 * km / sec);
+	propagator.Interpolate_Last_Step(1.0, r_interpolated, v_interpolated);
+	EXPECT_NEAR(r_interpolated, r_after, 1.0e-9 * rSun);
+	EXPECT_NEAR(v_interpolated, v_after, 1.0e-9 * km / sec);
+	propagator.Interpolate_Last_Step(0.5, r_interpolated, v_interpolated);
+	EXPECT_GT(r_interpolated, event.Radius());
+	EXPECT_LT(r_interpolated, r_after);
+	double t_after = propagator.Current_Time();
+	propagator.Rewind_Last_Step(0.5);
+	EXPECT_DOUBLE_EQ(propagator.Current_Time(), t_after / 2.0);
+	EXPECT_DOUBLE_EQ(propagator.Current_Radius(), r_interpolated);
+}
+
 TEST(TestSimulationTrajectory, TestPropagatorCurrentRadius)
 {
 	// ASSERT
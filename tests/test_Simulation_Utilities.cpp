@@ -1,5 +1,7 @@
 #include "gtest/gtest.h"
 
+#include "libphysica/Statistics.hpp"
+
 #include "obscura/Astronomy.hpp"
 #include "obscura/DM_Halo_Models.hpp"
 
@@ -164,6 +166,96 @@ TEST(TestSimulationUtilities, TestInitialConditions)
 	}
 }
 
+TEST(TestSimulationUtilities, TestInitialConditionsGenerator)
+{
+	// ARRANGE
+	std::mt19937 PRNG(3);
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+	Initial_Conditions_Generator generator(SHM, SSM);
+
+	double R_distance	= 1000 * AU;
+	unsigned int trials = 1000;
+	// ACT & ASSERT
+	for(unsigned int i = 0; i < trials; i++)
+	{
+		Event IC	= generator.Initial_Conditions(PRNG);
+		double r	= IC.Radius();
+		double v	= IC.Speed();
+		double vesc = SSM.Local_Escape_Speed(r);
+		double Jmax = rSun * sqrt(v * v + SSM.Local_Escape_Speed(rSun) * SSM.Local_Escape_Speed(rSun));
+		ASSERT_GE(IC.Radius(), R_distance);
+		ASSERT_GE(IC.Speed(), vesc);
+		ASSERT_LE(IC.Angular_Momentum(), Jmax);
+		ASSERT_GE(IC.Angular_Momentum(), 0.0);
+	}
+}
+
+TEST(TestSimulationUtilities, TestInitialConditionsGeneratorDistribution)
+{
+	// ARRANGE
+	std::mt19937 PRNG(5);
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+	libphysica::Vector vel_sun = SHM.Get_Observer_Velocity();
+	Initial_Conditions_Generator generator(SHM, SSM);
+
+	unsigned int trials	= 5000;
+	double u_rejection	= 0.0, u_table = 0.0, cos_rejection = 0.0, cos_table = 0.0;
+	// ACT
+	for(unsigned int i = 0; i < trials; i++)
+	{
+		Event IC_rejection = Initial_Conditions(SHM, SSM, PRNG);
+		Event IC_table	   = generator.Initial_Conditions(PRNG);
+		u_rejection += sqrt(IC_rejection.Asymptotic_Speed_Sqr(SSM)) / trials;
+		u_table += sqrt(IC_table.Asymptotic_Speed_Sqr(SSM)) / trials;
+		cos_rejection += IC_rejection.velocity.Normalized().Dot(vel_sun.Normalized()) / trials;
+		cos_table += IC_table.velocity.Normalized().Dot(vel_sun.Normalized()) / trials;
+	}
+	// ASSERT
+	EXPECT_NEAR(u_table, u_rejection, 15.0 * km / sec);
+	EXPECT_NEAR(cos_table, cos_rejection, 0.05);
+}
+
+TEST(TestSimulationUtilities, TestInitialConditionsGeneratorImportanceSampling)
+{
+	// ARRANGE
+	std::mt19937 PRNG(7);
+	Solar_Model SSM;
+	obscura::Standard_Halo_Model SHM;
+	Initial_Conditions_Generator generator(SHM, SSM);
+	Initial_Conditions_Generator generator_biased(SHM, SSM);
+	generator_biased.Set_Importance_Sampling(1.0, 2.0);
+
+	unsigned int trials	= 20000;
+	double weight_sum	= 0.0, u = 0.0, u_biased = 0.0, u_weighted = 0.0, b_sqr_biased = 0.0, b_sqr_weighted = 0.0;
+	// ACT
+	for(unsigned int i = 0; i < trials; i++)
+	{
+		double weight;
+		Event IC = generator.Initial_Conditions(PRNG, weight);
+		EXPECT_DOUBLE_EQ(weight, 1.0);
+		u += sqrt(IC.Asymptotic_Speed_Sqr(SSM)) / trials;
+
+		Event IC_biased = generator_biased.Initial_Conditions(PRNG, weight);
+		double u_i		= sqrt(IC_biased.Asymptotic_Speed_Sqr(SSM));
+		double v_esc	= SSM.Local_Escape_Speed(rSun);
+		double J_max	= rSun * sqrt(u_i * u_i + v_esc * v_esc);
+		double b_sqr	= pow(IC_biased.Angular_Momentum() / J_max, 2.0);
+		weight_sum += weight / trials;
+		u_biased += u_i / trials;
+		u_weighted += weight * u_i / trials;
+		b_sqr_biased += b_sqr / trials;
+		b_sqr_weighted += weight * b_sqr / trials;
+	}
+	// ASSERT
+	EXPECT_NEAR(weight_sum, 1.0, 0.03);
+	EXPECT_GT(u_biased, u);
+	EXPECT_NEAR(u_weighted, u, 15.0 * km / sec);
+	EXPECT_LT(b_sqr_biased, 0.4);
+	EXPECT_NEAR(b_sqr_weighted, 0.5, 0.03);
+}
+
 // 3. Analytically propagate a particle at event on a hyperbolic Kepler orbit to a radius R (without passing the periapsis)
 TEST(TestSimulationUtilities, TestHyperbolicKeplerShift)
 {
@@ -200,6 +292,74 @@ TEST(TestSimulationUtilities, TestHyperbolicKeplerShift)
 	}
 }
 
+TEST(TestSimulationUtilities, TestKeplerShift)
+{
+	// ARRANGE
+	int fixed_seed = 123;
+	std::mt19937 PRNG(fixed_seed);
+
+	double r_initial = 1.5 * rSun;
+	double vesc		 = sqrt(2.0 * G_Newton * mSun / r_initial);
+
+	int trials			  = 50;
+	int elliptic_orbits	  = 0;
+	int hyperbolic_orbits = 0;
+	for(int k = 0; k < trials; k++)
+	{
+		// Alternate between bound and unbound orbits
+		double v				= (k % 2 == 0) ? libphysica::Sample_Uniform(PRNG, 0.6 * vesc, 0.95 * vesc) : libphysica::Sample_Uniform(PRNG, 1.05 * vesc, 1.5 * vesc);
+		double cos_theta		= libphysica::Sample_Uniform(PRNG, -1.0, 1.0);
+		double phi				= libphysica::Sample_Uniform(PRNG, 0.0, 2.0 * M_PI);
+		libphysica::Vector axis = libphysica::Vector({1.0, 2.0, 3.0}).Normalized();
+		Event event(0.0, r_initial * axis, libphysica::Spherical_Coordinates(v, acos(cos_theta), phi, axis));
+
+		Event event_kepler = event;
+		if(!Kepler_Shift(event_kepler, rSun))
+			continue;
+		if(v < vesc)
+			elliptic_orbits++;
+		else
+			hyperbolic_orbits++;
+
+		Free_Particle_Propagator eom(event);
+		double time_before = eom.Current_Time();
+		while(eom.Current_Radius() > rSun)
+		{
+			time_before = eom.Current_Time();
+			eom.Runge_Kutta_45_Step(mSun);
+		}
+		Event x_ref = eom.Event_In_3D();
+		// ACT & ASSERT
+		for(int i = 0; i < 3; i++)
+			ASSERT_NEAR(event_kepler.position[i], x_ref.position[i], 0.001 * rSun);
+		for(int i = 0; i < 3; i++)
+			ASSERT_NEAR(event_kepler.velocity[i], x_ref.velocity[i], km / sec);
+		ASSERT_GE(event_kepler.time, time_before - minute);
+		ASSERT_LE(event_kepler.time, x_ref.time + minute);
+	}
+	EXPECT_GT(elliptic_orbits, 0);
+	EXPECT_GT(hyperbolic_orbits, 0);
+}
+
+TEST(TestSimulationUtilities, TestKeplerShiftUnreachableRadius)
+{
+	// ARRANGE
+	double r		= 2.0 * rSun;
+	double vesc		= sqrt(2.0 * G_Newton * mSun / r);
+	Event bound		= Event(0.0, libphysica::Vector({r, 0, 0}), libphysica::Vector({0, 0.9 * vesc, 0}));
+	Event outbound	= Event(0.0, libphysica::Vector({r, 0, 0}), libphysica::Vector({vesc, vesc, 0}));
+	Event reference	= bound;
+	// ACT & ASSERT
+	EXPECT_FALSE(Kepler_Shift(bound, rSun));
+	EXPECT_FALSE(Kepler_Shift(outbound, rSun));
+	EXPECT_DOUBLE_EQ(bound.time, reference.time);
+	for(int i = 0; i < 3; i++)
+		EXPECT_DOUBLE_EQ(bound.position[i], reference.position[i]);
+	EXPECT_TRUE(Kepler_Shift(outbound, 10.0 * rSun));
+	EXPECT_NEAR(outbound.Radius(), 10.0 * rSun, 1.0e-6 * rSun);
+	EXPECT_GT(outbound.time, 0.0);
+}
+
 // 4. Equiareal isodetection rings
 TEST(TestSimulationUtilities, TestIsoreflectionRingAngles)
 {
@@ -213,4 +373,42 @@ TEST(TestSimulationUtilities, TestIsoreflectionRingAngles)
 		EXPECT_NEAR(Isoreflection_Ring_Angles(2)[i], two_rings[i], tol);
 	for(unsigned int i = 0; i < hundred_rings.size(); i++)
 		EXPECT_NEAR(Isoreflection_Ring_Angles(10)[i], hundred_rings[i], tol);
-}
\ No newline at end of file
+}
+// 5. Counter-based random number streams
+TEST(TestSimulationUtilities, TestPhilox4x32)
+{
+	// ARRANGE
+	std::array<std::uint32_t, 4> counter = {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+	std::array<std::uint32_t, 2> key	 = {{0xa4093822, 0x299f31d0}};
+	// ACT
+	std::array<std::uint32_t, 4> zeros	= Philox_4x32({{0, 0, 0, 0}}, {{0, 0}});
+	std::array<std::uint32_t, 4> result = Philox_4x32(counter, key);
+	// ASSERT (known-answer tests of the Random123 library)
+	EXPECT_EQ(zeros[0], 0x6627e8d5u);
+	EXPECT_EQ(zeros[1], 0xe169c58du);
+	EXPECT_EQ(zeros[2], 0xbc57ac4cu);
+	EXPECT_EQ(zeros[3], 0x9b00dbd8u);
+	EXPECT_EQ(result[0], 0xd16cfe09u);
+	EXPECT_EQ(result[1], 0x94fdccebu);
+	EXPECT_EQ(result[2], 0x5001e420u);
+	EXPECT_EQ(result[3], 0x24126ea1u);
+}
+
+TEST(TestSimulationUtilities, TestSeedPRNGStream)
+{
+	// ARRANGE
+	std::mt19937 PRNG_1, PRNG_2, PRNG_3, PRNG_4;
+	// ACT
+	Seed_PRNG_Stream(PRNG_1, 42, 3, 1000);
+	Seed_PRNG_Stream(PRNG_2, 42, 3, 1000);
+	Seed_PRNG_Stream(PRNG_3, 42, 3, 1001);
+	Seed_PRNG_Stream(PRNG_4, 42, 4, 1000);
+	// ASSERT
+	for(int i = 0; i < 100; i++)
+	{
+		auto number = PRNG_1();
+		EXPECT_EQ(number, PRNG_2());
+		EXPECT_NE(number, PRNG_3());
+		EXPECT_NE(number, PRNG_4());
+	}
+}
@@ -1,11 +1,16 @@
 #include "gtest/gtest.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <mpi.h>
+#include <numeric>
 #include <random>
 
 #include "libphysica/Natural_Units.hpp"
 #include "libphysica/Statistics.hpp"
+#include "libphysica/Utilities.hpp"
 
 #include "obscura/DM_Particle_Standard.hpp"
 
@@ -107,6 +112,68 @@ TEST(TestSolarModel, TestNumberDensityElectron)
 	EXPECT_DOUBLE_EQ(SSM.Number_Density_Electron(1.5 * rSun), 0.0);
 }
 
+TEST(TestSolarModel, TestRadialGridLookup)
+{
+	// ARRANGE
+	std::mt19937 PRNG(123);
+	Solar_Model SSM;
+	int trials		 = 100;
+	double tolerance = 1.0e-6;
+	// ACT & ASSERT
+	for(int i = 0; i < trials; i++)
+	{
+		double r				= libphysica::Sample_Uniform(PRNG, 0.0, rSun);
+		Radial_Grid_Point point = SSM.Radial_Grid_Lookup(r);
+		EXPECT_NEAR(SSM.Mass(point), SSM.Mass(r), tolerance * SSM.Mass(r));
+		EXPECT_NEAR(SSM.Mass_Density(point), SSM.Mass_Density(r), tolerance * SSM.Mass_Density(r));
+		EXPECT_NEAR(SSM.Temperature(point), SSM.Temperature(r), tolerance * SSM.Temperature(r));
+		EXPECT_NEAR(SSM.Local_Escape_Speed(point), SSM.Local_Escape_Speed(r), tolerance * SSM.Local_Escape_Speed(r));
+		EXPECT_NEAR(SSM.Number_Density_Electron(point), SSM.Number_Density_Electron(r), tolerance * SSM.Number_Density_Electron(r));
+		for(unsigned int j = 0; j < SSM.target_isotopes.size(); j++)
+			EXPECT_NEAR(SSM.Number_Density_Nucleus(point, j), SSM.Number_Density_Nucleus(r, j), tolerance * SSM.Number_Density_Nucleus(r, j));
+	}
+	EXPECT_DOUBLE_EQ(SSM.Mass(SSM.Radial_Grid_Lookup(rSun)), mSun);
+	EXPECT_DOUBLE_EQ(SSM.Mass(SSM.Radial_Grid_Lookup(2.0 * rSun)), mSun);
+	EXPECT_DOUBLE_EQ(SSM.Number_Density_Nucleus(SSM.Radial_Grid_Lookup(2.0 * rSun), 0), 0.0);
+	EXPECT_DOUBLE_EQ(SSM.Local_Escape_Speed(SSM.Radial_Grid_Lookup(2.0 * rSun)), SSM.Local_Escape_Speed(2.0 * rSun));
+}
+
+TEST(TestSolarModel, TestRadialGridRawData)
+{
+	// ARRANGE
+	std::vector<double> units(35, 1.0);
+	units[0]							   = mSun;
+	units[1]							   = rSun;
+	units[2]							   = Kelvin;
+	units[3]							   = gram / cm / cm / cm;
+	std::vector<std::vector<double>> table = libphysica::Import_Table(PROJECT_DIR "/data/model_agss09.dat", units, 20);
+	Solar_Model SSM;
+	double tolerance = 1.0e-6;
+	// ACT & ASSERT
+	for(auto& row : table)
+	{
+		Radial_Grid_Point point = SSM.Radial_Grid_Lookup(row[1]);
+		EXPECT_NEAR(SSM.Mass(point), row[0], tolerance * row[0]);
+		EXPECT_NEAR(SSM.Temperature(point), row[2], tolerance * row[2]);
+		EXPECT_NEAR(SSM.Mass_Density(point), row[3], tolerance * row[3]);
+	}
+}
+
+TEST(TestSolarModel, TestScaleHeight)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	double r = 0.5 * rSun;
+	double h = 0.01 * rSun;
+	// ACT
+	double scale_height_density		= SSM.Mass_Density(r) * 2.0 * h / fabs(SSM.Mass_Density(r + h) - SSM.Mass_Density(r - h));
+	double scale_height_temperature = SSM.Temperature(r) * 2.0 * h / fabs(SSM.Temperature(r + h) - SSM.Temperature(r - h));
+	// ASSERT
+	EXPECT_NEAR(SSM.Scale_Height(SSM.Radial_Grid_Lookup(r)), std::min(scale_height_density, scale_height_temperature), 0.05 * std::min(scale_height_density, scale_height_temperature));
+	EXPECT_GT(SSM.Scale_Height(SSM.Radial_Grid_Lookup(0.0)), 0.0);
+	EXPECT_LE(SSM.Scale_Height(SSM.Radial_Grid_Lookup(0.0)), rSun);
+}
+
 TEST(TestSolarModel, TestDMScatteringRateElectron)
 {
 	// ARRANGE
@@ -140,6 +207,29 @@ TEST(TestSolarModel, TestDMScatteringRateNucleus)
 	EXPECT_DOUBLE_EQ(SSM.DM_Scattering_Rate_Nucleus(DM, r1, v_DM, 0), 0.0);
 }
 
+TEST(TestSolarModel, TestDMScatteringRates)
+{
+	// ARRANGE
+	Solar_Model SSM;
+	obscura::DM_Particle_SI DM;
+	DM.Set_Sigma_Proton(pb);
+	DM.Set_Sigma_Electron(pb);
+	double v_DM = 1e-3;
+	double r1	= 0.5 * rSun;
+	double r2	= 1.5 * rSun;
+	std::vector<double> rates;
+	// ACT
+	SSM.DM_Scattering_Rates(DM, SSM.Radial_Grid_Lookup(r1), v_DM, rates);
+	// ASSERT
+	ASSERT_EQ(rates.size(), SSM.target_isotopes.size() + 1);
+	EXPECT_DOUBLE_EQ(rates[0], SSM.DM_Scattering_Rate_Electron(DM, r1, v_DM));
+	for(unsigned int i = 0; i < SSM.target_isotopes.size(); i++)
+		EXPECT_DOUBLE_EQ(rates[i + 1], SSM.DM_Scattering_Rate_Nucleus(DM, r1, v_DM, i));
+	SSM.DM_Scattering_Rates(DM, SSM.Radial_Grid_Lookup(r2), v_DM, rates);
+	for(auto& rate : rates)
+		EXPECT_DOUBLE_EQ(rate, 0.0);
+}
+
 TEST(TestSolarModel, TestTotalDMScatteringRate)
 {
 	// ARRANGE
@@ -187,6 +277,134 @@ TEST(TestSolarModel, TestTotalDMScatteringRateInterpolation)
 	}
 }
 
+TEST(TestSolarModel, TestRateTableCache)
+{
+	// ARRANGE
+	std::mt19937 PRNG(999);
+	obscura::DM_Particle_SI DM(0.01);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(pb);
+	Solar_Model SSM_computed, SSM_exported, SSM_cached;
+	SSM_exported.Use_Rate_Table_Cache("./");
+	SSM_cached.Use_Rate_Table_Cache("./");
+	std::string cache_file = SSM_exported.Rate_Table_Cache_File(DM, 50, 50);
+	SSM_exported.Interpolate_Total_DM_Scattering_Rate(DM, 50, 50);
+	// ACT
+	DM.Set_Sigma_Proton(2.0 * pb);
+	std::string cache_file_rescaled = SSM_cached.Rate_Table_Cache_File(DM, 50, 50);
+	SSM_cached.Interpolate_Total_DM_Scattering_Rate(DM, 50, 50);
+	SSM_computed.Interpolate_Total_DM_Scattering_Rate(DM, 50, 50);
+	// ASSERT
+	EXPECT_FALSE(cache_file.empty());
+	EXPECT_EQ(cache_file_rescaled, cache_file);
+	EXPECT_TRUE(std::ifstream(cache_file).good());
+	EXPECT_TRUE(SSM_cached.Target_Fractions_Tabulated(0.3));
+	for(int i = 0; i < 100; i++)
+	{
+		double r  = libphysica::Sample_Uniform(PRNG, 0, rSun);
+		double w  = libphysica::Sample_Uniform(PRNG, 0, 0.3);
+		double xi = libphysica::Sample_Uniform(PRNG, 0, 1);
+		EXPECT_NEAR(SSM_cached.Total_DM_Scattering_Rate(DM, r, w), SSM_computed.Total_DM_Scattering_Rate(DM, r, w), 1.0e-6 * SSM_computed.Total_DM_Scattering_Rate(DM, r, w));
+		EXPECT_EQ(SSM_cached.Sample_Target_Tabulated(r, w, xi), SSM_computed.Sample_Target_Tabulated(r, w, xi));
+	}
+	std::remove(cache_file.c_str());
+}
+
+TEST(TestSolarModel, TestRescaleTotalDMScatteringRate)
+{
+	// ARRANGE
+	std::mt19937 PRNG(1001);
+	obscura::DM_Particle_SI DM(0.01);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(pb);
+	Solar_Model SSM_rescaled, SSM_computed;
+	SSM_rescaled.Interpolate_Total_DM_Scattering_Rate(DM, 50, 50);
+	obscura::DM_Particle_SI DM_heavy(0.1);
+	DM_heavy.Set_Low_Mass_Mode(true);
+	DM_heavy.Set_Sigma_Proton(pb);
+	// ACT
+	DM.Set_Sigma_Proton(3.0 * pb);
+	bool rescaled = SSM_rescaled.Rescale_Total_DM_Scattering_Rate(DM);
+	SSM_computed.Interpolate_Total_DM_Scattering_Rate(DM, 50, 50);
+	// ASSERT
+	EXPECT_TRUE(rescaled);
+	EXPECT_FALSE(SSM_rescaled.Rescale_Total_DM_Scattering_Rate(DM_heavy));
+	for(int i = 0; i < 100; i++)
+	{
+		double r = libphysica::Sample_Uniform(PRNG, 0, rSun);
+		double w = libphysica::Sample_Uniform(PRNG, 0, 0.3);
+		EXPECT_NEAR(SSM_rescaled.Total_DM_Scattering_Rate(DM, r, w), SSM_computed.Total_DM_Scattering_Rate(DM, r, w), 1.0e-6 * SSM_computed.Total_DM_Scattering_Rate(DM, r, w));
+	}
+}
+
+TEST(TestSolarModel, TestInterpolateTotalDMScatteringRateAdaptive)
+{
+	// ARRANGE
+	std::mt19937 PRNG(1002);
+	obscura::DM_Particle_SI DM(0.01);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(pb);
+	Solar_Model SSM;
+	double relative_accuracy = 0.05;
+	std::vector<double> radii, speeds, rates;
+	for(int i = 0; i < 100; i++)
+	{
+		radii.push_back(libphysica::Sample_Uniform(PRNG, 0, 0.95 * rSun));
+		speeds.push_back(1.0e-4 * pow(3000.0, libphysica::Sample_Uniform(PRNG)));
+		rates.push_back(SSM.Total_DM_Scattering_Rate_Computed(DM, radii.back(), speeds.back()));
+	}
+	auto largest_relative_error = [&SSM, &DM, &radii, &speeds, &rates]() {
+		double error = 0.0;
+		for(unsigned int i = 0; i < rates.size(); i++)
+			error = std::max(error, std::fabs(SSM.Total_DM_Scattering_Rate(DM, radii[i], speeds[i]) / rates[i] - 1.0));
+		return error;
+	};
+	// ACT
+	SSM.Interpolate_Total_DM_Scattering_Rate_Adaptive(DM, relative_accuracy, 200);
+	std::vector<unsigned int> grid = SSM.Rate_Table_Grid();
+	double adaptive_error		   = largest_relative_error();
+	double memory				   = SSM.Rate_Table_Memory();
+	double build_time			   = SSM.Rate_Table_Build_Time();
+	// A uniform grid with the same number of nodes per dimension
+	SSM.Interpolate_Total_DM_Scattering_Rate(DM, grid[0], grid[1]);
+	double uniform_error = largest_relative_error();
+	// ASSERT
+	ASSERT_EQ(grid.size(), 2);
+	EXPECT_LE(grid[0], 200);
+	EXPECT_LE(grid[1], 200);
+	EXPECT_DOUBLE_EQ(memory, (grid[0] * grid[1] + grid[0] + grid[1]) * sizeof(double));
+	EXPECT_GT(build_time, 0.0);
+	EXPECT_LT(adaptive_error, 3.0 * relative_accuracy);
+	// The uniform grid needs more nodes for the same accuracy.
+	EXPECT_GT(uniform_error, adaptive_error);
+}
+
+TEST(TestSolarModel, TestSampleTargetTabulated)
+{
+	// ARRANGE
+	std::mt19937 PRNG(42);
+	Solar_Model SSM;
+	obscura::DM_Particle_SI DM(0.1);
+	DM.Set_Low_Mass_Mode(true);
+	DM.Set_Sigma_Proton(pb);
+	DM.Set_Sigma_Electron(pb);
+	double r	= 0.3 * rSun;
+	double v_DM = 1e-3;
+	std::vector<double> rates;
+	SSM.DM_Scattering_Rates(DM, SSM.Radial_Grid_Lookup(r), v_DM, rates);
+	double total = std::accumulate(rates.begin(), rates.end(), 0.0);
+	int trials	 = 20000;
+	std::vector<double> frequencies(rates.size(), 0.0);
+	// ACT
+	SSM.Tabulate_Target_Fractions(DM);
+	for(int i = 0; i < trials; i++)
+		frequencies[SSM.Sample_Target_Tabulated(r, v_DM, libphysica::Sample_Uniform(PRNG)) + 1] += 1.0 / trials;
+	// ASSERT
+	ASSERT_TRUE(SSM.Target_Fractions_Tabulated(v_DM));
+	for(unsigned int i = 0; i < rates.size(); i++)
+		EXPECT_NEAR(frequencies[i], rates[i] / total, 0.015);
+}
+
 TEST(TestSolarModel, TestPrintSummary)
 {
 	// ARRANGE
@@ -0,0 +1,104 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "libphysica/Natural_Units.hpp"
+
+#include "Trajectory_Output.hpp"
+
+using namespace DaMaSCUS_SUN;
+using namespace libphysica::natural_units;
+
+std::vector<Trajectory_Record> Test_Records(unsigned int number_of_records)
+{
+	std::vector<Trajectory_Record> records(number_of_records);
+	for(unsigned int i = 0; i < number_of_records; i++)
+	{
+		records[i].time = i * sec;
+		for(int j = 0; j < 3; j++)
+		{
+			records[i].position[j] = (i + j) * km;
+			records[i].velocity[j] = (i - j) * km / sec;
+		}
+		records[i].energy = i * eV;
+	}
+	return records;
+}
+
+// 2. Buffered binary sink
+TEST(TestTrajectoryOutput, TestWriteAndImport)
+{
+	// ARRANGE
+	std::string filename						= "test_trajectories.bin";
+	std::vector<Trajectory_Record> trajectory_1	= Test_Records(5);
+	std::vector<Trajectory_Record> trajectory_2	= Test_Records(3);
+	// ACT
+	{
+		Trajectory_Writer writer(filename, 4);
+		EXPECT_EQ(writer.Write_Trajectory(trajectory_1), 0);
+		EXPECT_EQ(writer.Write_Trajectory(trajectory_2), 1);
+	}
+	std::vector<Trajectory_Record> records = Import_Trajectory_Records(filename);
+	// ASSERT
+	ASSERT_EQ(records.size(), 8);
+	for(unsigned int i = 0; i < records.size(); i++)
+	{
+		const Trajectory_Record& expected = (i < 5) ? trajectory_1[i] : trajectory_2[i - 5];
+		EXPECT_EQ(records[i].trajectory, (i < 5) ? 0 : 1);
+		EXPECT_DOUBLE_EQ(records[i].time, expected.time);
+		for(int j = 0; j < 3; j++)
+		{
+			EXPECT_DOUBLE_EQ(records[i].position[j], expected.position[j]);
+			EXPECT_DOUBLE_EQ(records[i].velocity[j], expected.velocity[j]);
+		}
+		EXPECT_DOUBLE_EQ(records[i].energy, expected.energy);
+	}
+	std::remove(filename.c_str());
+}
+
+// 3. Reading the binary files
+TEST(TestTrajectoryOutput, TestImportIncompleteFile)
+{
+	// ARRANGE
+	std::string filename				   = "test_trajectories_incomplete.bin";
+	std::vector<Trajectory_Record> records = Test_Records(2);
+	{
+		Trajectory_Writer writer(filename);
+		writer.Write_Trajectory(records);
+	}
+	// ACT
+	std::ofstream f(filename, std::ios::out | std::ios::binary | std::ios::app);
+	f.write(reinterpret_cast<const char*>(&records[0]), sizeof(Trajectory_Record) / 2);
+	f.close();
+	// ASSERT
+	EXPECT_EQ(Import_Trajectory_Records(filename).size(), 2);
+	std::remove(filename.c_str());
+}
+
+TEST(TestTrajectoryOutput, TestConvertTrajectoriesToText)
+{
+	// ARRANGE
+	std::string binary_filename			   = "test_trajectories_conversion.bin";
+	std::string text_filename			   = "test_trajectories_conversion.txt";
+	std::vector<Trajectory_Record> records = Test_Records(4);
+	{
+		Trajectory_Writer writer(binary_filename);
+		writer.Write_Trajectory(records);
+	}
+	// ACT
+	Convert_Trajectories_To_Text(binary_filename, text_filename);
+	// ASSERT
+	std::ifstream f(text_filename);
+	std::string header, line;
+	std::getline(f, header);
+	unsigned int lines = 0;
+	while(std::getline(f, line))
+		lines++;
+	EXPECT_EQ(header[0], '#');
+	EXPECT_EQ(lines, records.size());
+	std::remove(binary_filename.c_str());
+	std::remove(text_filename.c_str());
+}